@@ -0,0 +1,639 @@
+// buffercache.cc
+//	Routines to keep recently used disk sectors in memory.
+//
+//	Each block of the cache holds one sector.  Blocks are found by
+//	sector number through "blockOf", a table with an entry for every
+//	sector on the disk, so a lookup is a single array reference.
+//	The blocks are also on a doubly linked list, in the order they
+//	were last used; the one at the end is the one to evict.
+//
+//	A lock keeps threads out of each other's way while they look at
+//	or change the cache, but it is let go while a thread waits for
+//	the disk, so that other threads can use other blocks, and queue
+//	up their own disk requests, meanwhile.  A block whose sector is
+//	on its way in or out is marked "busy" until the transfer is done:
+//	nobody may use it, change it, or evict it, and a thread that
+//	wants it waits.
+//
+//	Read ahead finishes in the disk interrupt handler, which cannot
+//	take the lock.  So everything about a block that will be read
+//	ahead is settled when it is asked for, by a thread holding the
+//	lock; the interrupt handler only clears "busy".
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "buffercache.h"
+
+#include "copyright.h"
+#include "debug.h"
+#include "journal.h"
+#include "main.h"
+#include "synch.h"
+#include "synchdisk.h"
+
+//----------------------------------------------------------------------
+// BlockArrival::CallBack
+// 	Disk interrupt handler, for a sector read ahead into a block.
+//----------------------------------------------------------------------
+
+void BlockArrival::CallBack() {
+    cache->Arrived(block);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::BufferCache
+// 	Initialize a cache with nothing in it.
+//
+//	"disk" -- the disk the sectors are on
+//	"numBlocks" -- how many sectors to keep in memory at once
+//----------------------------------------------------------------------
+
+BufferCache::BufferCache(SynchDisk *disk, int numBlocks) {
+    int i;
+
+    ASSERT(numBlocks > 0);
+    this->disk = disk;
+    this->numBlocks = numBlocks;
+    lock = new Lock("buffer cache");
+    data = new char[numBlocks * SectorSize];
+    sectorOf = new int[numBlocks];
+    dirty = new bool[numBlocks];
+    pinned = new bool[numBlocks];
+    newer = new int[numBlocks];
+    older = new int[numBlocks];
+    blockOf = new int[NumSectors];
+    for (i = 0; i < NumSectors; i++) {
+        blockOf[i] = -1;
+    }
+
+    // all the blocks are empty; put them on the list in order
+    for (i = 0; i < numBlocks; i++) {
+        sectorOf[i] = -1;
+        dirty[i] = FALSE;
+        pinned[i] = FALSE;
+        newer[i] = i - 1;
+        older[i] = (i + 1 < numBlocks) ? i + 1 : -1;
+    }
+    mostRecent = 0;
+    leastRecent = numBlocks - 1;
+    lastFlush = 0;
+    journal = NULL;
+
+    busy = new bool[numBlocks];
+    arrivals = new BlockArrival[numBlocks];
+    for (i = 0; i < numBlocks; i++) {
+        busy[i] = FALSE;
+        arrivals[i].cache = this;
+        arrivals[i].block = i;
+    }
+    numArriving = 0;
+    notBusy = new Semaphore("cache block", 0);
+    numWaiting = 0;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::~BufferCache
+// 	De-allocate the cache.  Dirty blocks are not written back; call
+//	Sync first to keep them.
+//----------------------------------------------------------------------
+
+BufferCache::~BufferCache() {
+    delete lock;
+    delete[] data;
+    delete[] sectorOf;
+    delete[] dirty;
+    delete[] pinned;
+    delete[] newer;
+    delete[] older;
+    delete[] blockOf;
+    delete[] busy;
+    delete[] arrivals;
+    delete notBusy;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Unlink
+// 	Take a block off the list of blocks in the order they were used.
+//----------------------------------------------------------------------
+
+void BufferCache::Unlink(int block) {
+    if (newer[block] >= 0) {
+        older[newer[block]] = older[block];
+    } else {
+        mostRecent = older[block];
+    }
+    if (older[block] >= 0) {
+        newer[older[block]] = newer[block];
+    } else {
+        leastRecent = newer[block];
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::MakeNewest
+// 	Put a block (not on the list) at the most recently used end.
+//----------------------------------------------------------------------
+
+void BufferCache::MakeNewest(int block) {
+    newer[block] = -1;
+    older[block] = mostRecent;
+    if (mostRecent >= 0) {
+        newer[mostRecent] = block;
+    } else {
+        leastRecent = block;
+    }
+    mostRecent = block;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WaitForBlock
+// 	Let go of the lock until some busy block is done, then take it
+//	again.  Anything may have changed meanwhile, so the caller has to
+//	look again at whatever it was waiting for.  The caller holds the
+//	lock.
+//----------------------------------------------------------------------
+
+void BufferCache::WaitForBlock() {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    numWaiting++;
+    lock->Release();
+    notBusy->P();
+    (void)kernel->interrupt->SetLevel(oldLevel);
+    lock->Acquire();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WakeWaiters
+// 	A block has stopped being busy; wake up every thread waiting for
+//	one.  Called from the disk interrupt handler, or by a thread.
+//----------------------------------------------------------------------
+
+void BufferCache::WakeWaiters() {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    while (numWaiting > 0) {
+        numWaiting--;
+        notBusy->V();
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteBackBlock
+// 	Write a block to its sector on disk, if it has changed.  The
+//	caller holds the lock, and the block must not be busy.
+//----------------------------------------------------------------------
+
+void BufferCache::WriteBackBlock(int block) {
+    ASSERT(!busy[block]);
+    if (dirty[block]) {
+        WriteBackRun(sectorOf[block], 1);
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteBackRun
+// 	Write a run of consecutive sectors to disk, with one request.
+//	Their blocks are busy, and the lock let go, while they are being
+//	written.  The caller holds the lock; the blocks must all be dirty
+//	and not busy.
+//
+//	"firstSector" -- the first sector of the run
+//	"numSectors" -- how many sectors
+//----------------------------------------------------------------------
+
+void BufferCache::WriteBackRun(int firstSector, int numSectors) {
+    char *buffer = new char[numSectors * SectorSize];
+    int i, block;
+
+    DEBUG(dbgFile, "Cache writing back " << numSectors << " sectors from " << firstSector);
+    for (i = 0; i < numSectors; i++) {
+        block = blockOf[firstSector + i];
+        ASSERT(block >= 0 && dirty[block] && !busy[block]);
+        bcopy(Block(block), &buffer[i * SectorSize], SectorSize);
+        busy[block] = TRUE;
+        dirty[block] = FALSE;
+    }
+    lock->Release();
+    disk->WriteSectors(firstSector, numSectors, buffer);
+    lock->Acquire();
+    for (i = 0; i < numSectors; i++) {
+        busy[blockOf[firstSector + i]] = FALSE;
+    }
+    delete[] buffer;
+    WakeWaiters();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadIn
+// 	Read in as many as "maxSectors" consecutive sectors, starting at
+//	"firstSector", with one disk request.  It stops at the first one
+//	that is cached, at MaxRunSectors, or when it runs out of blocks
+//	that are clean and not busy; the blocks taken are made the most
+//	recently used.  Return how many were read in: 0 if "firstSector"
+//	itself is cached, or there is no block to spare for it.
+//
+//	The caller holds the lock.  The lock is let go during the read,
+//	but is held again when we return, so the blocks are there.
+//----------------------------------------------------------------------
+
+int BufferCache::ReadIn(int firstSector, int maxSectors) {
+    int blocks[MaxRunSectors];
+    int count = 0;
+    int block = leastRecent;
+    char *buffer;
+    int i;
+
+    while (count < maxSectors && count < MaxRunSectors &&
+           blockOf[firstSector + count] < 0) {
+        while (block >= 0 && (dirty[block] || busy[block])) {
+            block = newer[block];
+        }
+        if (block < 0) {
+            break;
+        }
+        blocks[count++] = block;
+        block = newer[block];
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    DEBUG(dbgFile, "Cache reading in " << count << " sectors from " << firstSector);
+    for (i = 0; i < count; i++) {
+        block = blocks[i];
+        if (sectorOf[block] >= 0) {
+            blockOf[sectorOf[block]] = -1;
+        }
+        sectorOf[block] = firstSector + i;
+        blockOf[firstSector + i] = block;
+        Unlink(block);
+        MakeNewest(block);
+        busy[block] = TRUE;
+    }
+    kernel->stats->numCacheMisses += count;
+
+    buffer = new char[count * SectorSize];
+    lock->Release();
+    disk->ReadSectors(firstSector, count, buffer);
+    lock->Acquire();
+    for (i = 0; i < count; i++) {
+        bcopy(&buffer[i * SectorSize], Block(blocks[i]), SectorSize);
+        busy[blocks[i]] = FALSE;
+    }
+    delete[] buffer;
+    WakeWaiters();
+    return count;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Get
+// 	Return the block holding a sector, and make it the most recently
+//	used.  If the sector is not cached, the least recently used block
+//	that is not busy or pinned is written back if need be, and reused
+//	for it.
+//
+//	Whenever the lock has been let go, to wait for a busy block or
+//	for the disk, we start over.  The block returned is not busy.
+//
+//	"sector" -- the sector wanted
+//	"fill" -- should the block be read from disk if it is not cached?
+//		FALSE if the caller is about to overwrite all of it.
+//----------------------------------------------------------------------
+
+int BufferCache::Get(int sector, bool fill) {
+    bool counted = FALSE;  // as a hit or a miss yet?
+    int block;
+
+    ASSERT(sector >= 0 && sector < NumSectors);
+    for (;;) {
+        block = blockOf[sector];
+        if (block >= 0) {
+            if (!counted) {
+                kernel->stats->numCacheHits++;
+                counted = TRUE;
+            }
+            if (busy[block]) {
+                WaitForBlock();
+                continue;
+            }
+            Unlink(block);
+            MakeNewest(block);
+            return block;
+        }
+
+        if (!counted) {
+            kernel->stats->numCacheMisses++;
+            counted = TRUE;
+        }
+        block = leastRecent;
+        while (block >= 0 && (busy[block] || pinned[block])) {  // it is spoken for
+            block = newer[block];
+        }
+        if (block < 0) {
+            WaitForBlock();
+            continue;
+        }
+        if (dirty[block]) {
+            WriteBackBlock(block);
+            continue;
+        }
+        if (sectorOf[block] >= 0) {
+            blockOf[sectorOf[block]] = -1;
+        }
+        sectorOf[block] = sector;
+        blockOf[sector] = block;
+        Unlink(block);
+        MakeNewest(block);
+        if (fill) {
+            busy[block] = TRUE;
+            lock->Release();
+            disk->ReadSector(sector, Block(block));
+            lock->Acquire();
+            busy[block] = FALSE;
+            WakeWaiters();
+        }
+        return block;
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadAhead
+// 	Get a sector that will soon be read into the cache, without
+//	waiting for it.  Nothing is done if the sector is already cached,
+//	if too many are being read ahead already, or if there is no block
+//	to spare: read ahead never writes a dirty block back to make room.
+//
+//	The block taken is made the most recently used, since it is
+//	expected to be wanted soon.  It stays busy until the sector is in.
+//
+//	"sector" -- the disk sector to read
+//----------------------------------------------------------------------
+
+void BufferCache::ReadAhead(int sector) {
+    int block;
+
+    ASSERT(sector >= 0 && sector < NumSectors);
+    lock->Acquire();
+    if (blockOf[sector] < 0 && numArriving < MaxReadAhead) {
+        for (block = leastRecent; block >= 0; block = newer[block]) {
+            if (!dirty[block] && !busy[block]) {
+                break;
+            }
+        }
+        if (block >= 0) {
+            DEBUG(dbgFile, "Reading ahead sector " << sector);
+            if (sectorOf[block] >= 0) {
+                blockOf[sectorOf[block]] = -1;
+            }
+            sectorOf[block] = sector;
+            blockOf[sector] = block;
+            Unlink(block);
+            MakeNewest(block);
+            busy[block] = TRUE;
+            numArriving++;
+            disk->ReadAhead(sector, Block(block), &arrivals[block]);
+        }
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Arrived
+// 	Called by the disk interrupt handler, when a sector read ahead is
+//	in.  The block can be used now; wake up anyone waiting.
+//
+//	"block" -- the block the sector was read into
+//----------------------------------------------------------------------
+
+void BufferCache::Arrived(int block) {
+    ASSERT(busy[block]);
+    busy[block] = FALSE;
+    numArriving--;
+    WakeWaiters();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSector
+// BufferCache::WriteSector
+// 	Read or write a whole sector.  A write only changes the copy in
+//	the cache; the sector does not have to be read in first.
+//
+//	"sector" -- the disk sector
+//	"buffer" -- the sector's contents
+//----------------------------------------------------------------------
+
+void BufferCache::ReadSector(int sector, char *buffer) {
+    Read(sector, buffer, 0, SectorSize);
+}
+
+void BufferCache::WriteSector(int sector, char *buffer) {
+    Write(sector, buffer, 0, SectorSize);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Read
+// 	Copy part of a sector, reading the sector in if it is not
+//	already in the cache.
+//
+//	"sector" -- the disk sector
+//	"into" -- where to put the bytes
+//	"offset" -- where in the sector they start
+//	"numBytes" -- how many of them
+//----------------------------------------------------------------------
+
+void BufferCache::Read(int sector, char *into, int offset, int numBytes) {
+    ASSERT(offset >= 0 && numBytes >= 0 && offset + numBytes <= SectorSize);
+    lock->Acquire();
+    FlushIfDue();
+    bcopy(Block(Get(sector, TRUE)) + offset, into, numBytes);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadRun
+// 	Copy bytes from a run of sectors that are consecutive on disk.
+//	The ones that are not cached are read in together, so that a run
+//	of them costs one disk request rather than one for each.
+//
+//	"firstSector" -- the first disk sector of the run
+//	"into" -- where to put the bytes
+//	"offset" -- where in the first sector they start
+//	"numBytes" -- how many of them; they may go on through as many
+//		of the following sectors as need be
+//----------------------------------------------------------------------
+
+void BufferCache::ReadRun(int firstSector, char *into, int offset, int numBytes) {
+    int lastSector = firstSector + divRoundUp(offset + numBytes, SectorSize) - 1;
+    int sector = firstSector;
+    int done = 0;
+    int count, n;
+
+    ASSERT(offset >= 0 && offset < SectorSize && numBytes > 0);
+    ASSERT(firstSector >= 0 && lastSector < NumSectors);
+    lock->Acquire();
+    FlushIfDue();
+    while (done < numBytes) {
+        count = 0;
+        if (blockOf[sector] < 0) {
+            count = ReadIn(sector, lastSector - sector + 1);
+        }
+        if (count == 0) {  // cached, or no clean block to put it in
+            Get(sector, TRUE);
+            count = 1;
+        }
+        for (; count > 0; count--, sector++) {
+            n = min(SectorSize - offset, numBytes - done);
+            bcopy(Block(blockOf[sector]) + offset, &into[done], n);
+            done += n;
+            offset = 0;
+        }
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Write
+// 	Change part of a sector.  The sector is read in first unless all
+//	of it is being written.  It is only written to disk later, and if
+//	the journal says it is part of a transaction, not until that
+//	commits.
+//
+//	"sector" -- the disk sector
+//	"from" -- the new bytes
+//	"offset" -- where in the sector they go
+//	"numBytes" -- how many of them
+//----------------------------------------------------------------------
+
+void BufferCache::Write(int sector, char *from, int offset, int numBytes) {
+    int block;
+
+    ASSERT(offset >= 0 && numBytes >= 0 && offset + numBytes <= SectorSize);
+    lock->Acquire();
+    FlushIfDue();
+    block = Get(sector, numBytes < SectorSize);
+    bcopy(from, Block(block) + offset, numBytes);
+    dirty[block] = TRUE;
+    if (journal != NULL && journal->Written(sector)) {
+        pinned[block] = TRUE;
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Discard
+// 	Forget a sector that is no longer part of any file, so that its
+//	old contents are not written back.  Its block is reused first.
+//	The journal is told, so that it is not written back from the log
+//	either.
+//
+//	"sector" -- the disk sector that has been freed
+//----------------------------------------------------------------------
+
+void BufferCache::Discard(int sector) {
+    int block;
+
+    lock->Acquire();
+    if (journal != NULL) {
+        journal->Freed(sector);
+    }
+    while ((block = blockOf[sector]) >= 0 && busy[block]) {
+        WaitForBlock();
+    }
+    if (block >= 0) {
+        blockOf[sector] = -1;
+        sectorOf[block] = -1;
+        dirty[block] = FALSE;
+        pinned[block] = FALSE;
+        Unlink(block);
+        // put it at the least recently used end
+        newer[block] = leastRecent;
+        older[block] = -1;
+        if (leastRecent >= 0) {
+            older[leastRecent] = block;
+        } else {
+            mostRecent = block;
+        }
+        leastRecent = block;
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Unpin
+// 	The journal has committed the transaction a sector was written
+//	by: it is now an ordinary dirty sector, written back in time.
+//
+//	"sector" -- the disk sector
+//----------------------------------------------------------------------
+
+void BufferCache::Unpin(int sector) {
+    lock->Acquire();
+    ASSERT(blockOf[sector] >= 0);
+    pinned[blockOf[sector]] = FALSE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Flush
+// 	Write back every dirty block, in sector order, so that the disk
+//	head sweeps across the disk once.  Dirty sectors that are next to
+//	each other go in one request.  A busy block is skipped: it is
+//	either being read, so clean, or already being written back.  So
+//	is a pinned one, until its transaction commits.
+//	The caller holds the lock.
+//----------------------------------------------------------------------
+
+void BufferCache::Flush() {
+    int sector = 0;
+
+    while (sector < NumSectors) {
+        int count = 0;
+
+        while (sector + count < NumSectors && count < MaxRunSectors &&
+               blockOf[sector + count] >= 0 &&
+               dirty[blockOf[sector + count]] &&
+               !busy[blockOf[sector + count]] &&
+               !pinned[blockOf[sector + count]]) {
+            count++;
+        }
+        if (count > 0) {
+            WriteBackRun(sector, count);
+            sector += count;
+        } else {
+            sector++;
+        }
+    }
+    lastFlush = kernel->stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::FlushIfDue
+// 	Flush the cache if it has not been flushed for a while, so that
+//	changes do not sit in memory indefinitely.  The caller holds the
+//	lock.
+//----------------------------------------------------------------------
+
+void BufferCache::FlushIfDue() {
+    if (kernel->stats->totalTicks - lastFlush >= CacheFlushInterval) {
+        DEBUG(dbgFile, "Periodic flush of the buffer cache");
+        lastFlush = kernel->stats->totalTicks;  // so only one thread does it
+        Flush();
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Sync
+// 	Write every changed sector back to disk, except those of a
+//	transaction that has not committed.  Called when Nachos halts,
+//	and whenever the disk has to be up to date.
+//----------------------------------------------------------------------
+
+void BufferCache::Sync() {
+    lock->Acquire();
+    Flush();
+    lock->Release();
+}
@@ -0,0 +1,152 @@
+// buffercache.h
+//	Data structures for keeping recently used disk sectors in memory.
+//
+//	Every read or write of the file system goes through the cache:
+//	file headers, directories, the free sector map, and file data.
+//	A sector that is read again is found in memory, with no trip to
+//	the disk; a sector that is written is only marked dirty, and
+//	goes to disk when it is evicted, when the cache is flushed every
+//	so often, or on Sync.
+//
+//	When the cache is full, the least recently used sector makes
+//	room for the new one.
+//
+//	Sectors can also be asked for before they are needed (read
+//	ahead).  They are queued for the disk without anybody waiting;
+//	whoever wants one before it has arrived waits for it.
+//
+//	Threads do not hold up the cache while they wait for the disk,
+//	so several of them can have requests queued for it at once.
+//
+//	Sectors that are next to each other on disk are read in, and
+//	written back, together, with one disk request for the lot.
+//
+//	While a file system transaction is going on, the sectors it
+//	writes are pinned: they stay in the cache, and are not written
+//	back, until the journal has a copy of them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BUFFERCACHE_H
+#define BUFFERCACHE_H
+
+#include "callback.h"
+#include "copyright.h"
+#include "disk.h"
+
+class Journal;
+class Lock;
+class Semaphore;
+class SynchDisk;
+
+const int NumCacheBlocks = 64;         // sectors kept in memory
+const int CacheFlushInterval = 100000; // ticks between flushes of
+                                       // the dirty sectors
+const int MaxReadAhead = 8;            // most sectors waiting to be
+                                       // read ahead
+const int MaxRunSectors = 16;          // most sectors read or written
+                                       // with one disk request
+
+class BufferCache;
+
+// The disk interrupt handler calls one of these when a sector read
+// ahead into a block of the cache has arrived.
+
+class BlockArrival : public CallBackObj {
+   public:
+    BufferCache *cache;  // whose block
+    int block;           // which one
+
+    void CallBack();     // tell the cache
+};
+
+// The following class defines the kernel's cache of disk sectors,
+// between the file system and the synchronous disk.
+
+class BufferCache {
+   public:
+    BufferCache(SynchDisk *disk, int numBlocks);
+    // Initialize an empty cache of "numBlocks"
+    // sectors of "disk"
+    ~BufferCache();  // De-allocate the cache; anything
+                     // not yet Sync'ed is lost
+
+    void ReadSector(int sector, char *buffer);
+    void WriteSector(int sector, char *buffer);
+    // Read/write a whole sector
+
+    void Read(int sector, char *into, int offset, int numBytes);
+    void Write(int sector, char *from, int offset, int numBytes);
+    // Read/write part of a sector
+
+    void ReadRun(int firstSector, char *into, int offset, int numBytes);
+    // Read from consecutive sectors, starting
+    // "offset" bytes into firstSector
+
+    void Discard(int sector);  // The sector has been freed; don't
+                               // bother writing it back
+
+    void SetJournal(Journal *j) { journal = j; }
+    // Tell the journal about writes and frees
+    void Unpin(int sector);  // The journal has a copy of the sector;
+                             // it can be written back now
+
+    void ReadAhead(int sector);  // Start reading in a sector that will
+                                 // be wanted soon, if there is room
+
+    void Arrived(int block);  // A sector read ahead has arrived
+
+    void Sync();  // Write every dirty sector to disk
+
+   private:
+    SynchDisk *disk;   // where the sectors come from
+    Lock *lock;        // one thread looking at the cache at a
+                       // time (but not while it waits for I/O)
+    int numBlocks;     // how many sectors fit
+    char *data;        // their contents, a sector per block
+    int *sectorOf;     // which sector is in each block (-1: none)
+    bool *dirty;       // has the block been written since
+                       // it was read or last written back?
+    int *blockOf;      // which block each disk sector is in,
+                       // or -1 if it is not cached
+    int *newer;        // the blocks, on a list from the most
+    int *older;        // recently used (mostRecent) to the
+    int mostRecent;    // least (leastRecent), linked in both
+    int leastRecent;   // directions; -1 ends the list
+    int lastFlush;     // totalTicks of the last flush
+    bool *pinned;      // is the block part of a transaction that
+                       // has not committed?  It is dirty, and may
+                       // not be written back or evicted
+    Journal *journal;  // told of sectors written, or NULL
+
+    bool *busy;        // is the block being read in or written
+                       // back?  If so, it may not be used,
+                       // changed, or evicted until it is done
+    BlockArrival *arrivals;  // what to call when a block read
+                             // ahead is in, for each block
+    int numArriving;   // blocks being read ahead
+    Semaphore *notBusy;  // V'ed, once for each waiting thread,
+    int numWaiting;      // whenever a block stops being busy
+
+    char *Block(int block) { return &data[block * SectorSize]; }
+
+    int Get(int sector, bool fill);
+    // Make "sector" the most recently used
+    // block, reading it in if "fill"
+    void Unlink(int block);     // take a block off the LRU list
+    void MakeNewest(int block); // put it at the front
+    int ReadIn(int firstSector, int maxSectors);
+    // Read uncached sectors in, with one
+    // request; return how many
+    void WriteBackBlock(int block);  // write it if dirty
+    void WriteBackRun(int firstSector, int numSectors);
+    // write dirty sectors with one request
+    void Flush();               // write back every dirty block
+    void FlushIfDue();          // Flush, every CacheFlushInterval
+    void WaitForBlock();        // until some busy block is done
+    void WakeWaiters();         // a busy block is done
+};
+
+#endif  // BUFFERCACHE_H
@@ -7,13 +7,19 @@
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
+//	The table is a hash table: a name is looked for first in the
+//	entry its hash value picks, then in the ones after it, until
+//	it is found or an unused entry is reached.  So that an unused
+//	entry always ends the search, removing a name moves up any
+//	entries after it that belong further up.
+//
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
+//	The table does not grow by itself.  Once it is 3/4 full, Add
+//	fails; the caller can then Resize it, and make the file it is
+//	kept in bigger to match.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -22,6 +28,7 @@
 #include "directory.h"
 
 #include "copyright.h"
+#include "debug.h"
 #include "filehdr.h"
 #include "utility.h"
 
@@ -38,6 +45,7 @@
 Directory::Directory(int size) {
     table = new DirectoryEntry[size];
     tableSize = size;
+    numUsed = 0;
     for (int i = 0; i < tableSize; i++)
         table[i].inUse = FALSE;
 }
@@ -53,13 +61,21 @@ Directory::~Directory() {
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  The table is as
+//	big as the file.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
 
 void Directory::FetchFrom(OpenFile *file) {
+    delete[] table;
+    tableSize = file->Length() / sizeof(DirectoryEntry);
+    table = new DirectoryEntry[tableSize];
     (void)file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    numUsed = 0;
+    for (int i = 0; i < tableSize; i++)
+        if (table[i].inUse)
+            numUsed++;
 }
 
 //----------------------------------------------------------------------
@@ -70,20 +86,43 @@ void Directory::FetchFrom(OpenFile *file) {
 //----------------------------------------------------------------------
 
 void Directory::WriteBack(OpenFile *file) {
+    ASSERT(file->Length() == (int)(tableSize * sizeof(DirectoryEntry)));
     (void)file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
 }
 
+//----------------------------------------------------------------------
+// Directory::Home
+// 	Return the entry a name hashes to: where it goes, unless that
+//	entry (and maybe others after it) are taken.  The hash is FNV-1a.
+//
+//	"name" -- the file name
+//----------------------------------------------------------------------
+
+int Directory::Home(char *name) {
+    unsigned int hash = 2166136261u;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash % tableSize;
+}
+
 //----------------------------------------------------------------------
 // Directory::FindIndex
 // 	Look up file name in directory, and return its location in the table of
 //	directory entries.  Return -1 if the name isn't in the directory.
 //
+//	Names are compared whole: a name longer than FileNameMaxLen
+//	can't be in the directory, even if it starts with one that is.
+//
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
 
 int Directory::FindIndex(char *name) {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
+    if (tableSize == 0 || strlen(name) > FileNameMaxLen)
+        return -1;
+    for (int i = Home(name); table[i].inUse; i = (i + 1) % tableSize)
+        if (!strcmp(table[i].name, name))
             return i;
     return -1;  // name not in directory
 }
@@ -105,29 +144,45 @@ int Directory::Find(char *name) {
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Directory::IsDirectory
+// 	Return TRUE if a name in the directory is that of a subdirectory.
+//
+//	"name" -- the file name to look up
+//----------------------------------------------------------------------
+
+bool Directory::IsDirectory(char *name) {
+    int i = FindIndex(name);
+
+    return (i != -1) && table[i].isDirectory;
+}
+
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory, if
+//	it is too long, or if the directory is full, and has no more
+//	space for additional file names.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDirectory" -- is the file a directory?
 //----------------------------------------------------------------------
 
-bool Directory::Add(char *name, int newSector) {
-    if (FindIndex(name) != -1)
+bool Directory::Add(char *name, int newSector, bool isDirectory) {
+    int i;
+
+    if (FindIndex(name) != -1 || strlen(name) > FileNameMaxLen || IsFull())
         return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen);
-            table[i].sector = newSector;
-            return TRUE;
-        }
-    return FALSE;  // no space.  Fix when we have extensible files.
+    for (i = Home(name); table[i].inUse; i = (i + 1) % tableSize)
+        ;
+    table[i].inUse = TRUE;
+    table[i].isDirectory = isDirectory;
+    strncpy(table[i].name, name, FileNameMaxLen + 1);
+    table[i].sector = newSector;
+    numUsed++;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -135,27 +190,105 @@ bool Directory::Add(char *name, int newSector) {
 // 	Remove a file name from the directory.  Return TRUE if successful;
 //	return FALSE if the file isn't in the directory.
 //
+//	The entries after it, up to the next unused one, are looked at:
+//	any whose name hashes to the removed entry or before it (going
+//	around the end of the table) is moved into the hole, leaving a
+//	hole where it was, and so on.
+//
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
 bool Directory::Remove(char *name) {
-    int i = FindIndex(name);
+    int hole = FindIndex(name);
+    int i, home;
 
-    if (i == -1)
+    if (hole == -1)
         return FALSE;  // name not in directory
-    table[i].inUse = FALSE;
+    table[hole].inUse = FALSE;
+    numUsed--;
+    for (i = (hole + 1) % tableSize; table[i].inUse; i = (i + 1) % tableSize) {
+        home = Home(table[i].name);
+        // can it move back to the hole: is home outside (hole, i]?
+        if ((hole < i) ? (home <= hole || home > i) : (home <= hole && home > i)) {
+            table[hole] = table[i];
+            table[i].inUse = FALSE;
+            hole = i;
+        }
+    }
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Directory::IsFull, IsEmpty, TableSize
+// 	Is the table 3/4 full (so that Add will fail), or is it empty?
+//	How many entries does it have?
+//----------------------------------------------------------------------
+
+bool Directory::IsFull() {
+    return 4 * (numUsed + 1) > 3 * tableSize;
+}
+
+bool Directory::IsEmpty() {
+    return numUsed == 0;
+}
+
+int Directory::TableSize() {
+    return tableSize;
+}
+
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Put the names into a new table of a different size.  The caller
+//	has to make the directory's file match, before WriteBack.
+//
+//	"size" is the number of entries in the new table
+//----------------------------------------------------------------------
+
+void Directory::Resize(int size) {
+    DirectoryEntry *old = table;
+    int oldSize = tableSize;
+
+    ASSERT(4 * numUsed <= 3 * size);
+    table = new DirectoryEntry[size];
+    tableSize = size;
+    numUsed = 0;
+    for (int i = 0; i < tableSize; i++)
+        table[i].inUse = FALSE;
+    for (int i = 0; i < oldSize; i++) {
+        if (old[i].inUse) {
+            ASSERT(Add(old[i].name, old[i].sector, old[i].isDirectory));
+        }
+    }
+    delete[] old;
+}
+
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory.
+// 	List all the file names in the directory, and in the directories
+//	under it, each with the path to it.  Directory names end in '/'.
+//
+//	"path" -- the path to this directory, ending in '/'
 //----------------------------------------------------------------------
 
-void Directory::List() {
+void Directory::List(const char *path) {
     for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse)
-            printf("%s\n", table[i].name);
+        if (table[i].inUse) {
+            if (table[i].isDirectory) {
+                char *subPath = new char[strlen(path) + FileNameMaxLen + 2];
+                OpenFile *file = new OpenFile(table[i].sector);
+                Directory *sub = new Directory(0);
+
+                sprintf(subPath, "%s%s/", path, table[i].name);
+                printf("%s\n", subPath);
+                sub->FetchFrom(file);
+                sub->List(subPath);
+                delete sub;
+                delete file;
+                delete[] subPath;
+            } else {
+                printf("%s%s\n", path, table[i].name);
+            }
+        }
 }
 
 //----------------------------------------------------------------------
@@ -170,7 +303,8 @@ void Directory::Print() {
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
         if (table[i].inUse) {
-            printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
+            printf("Name: %s%s, Sector: %d\n", table[i].name,
+                   table[i].isDirectory ? "/" : "", table[i].sector);
             hdr->FetchFrom(table[i].sector);
             hdr->Print();
         }
@@ -19,8 +19,8 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen 9  // for simplicity, we assume
-                          // file names are <= 9 characters long
+#define FileNameMaxLen 55  // longest file name; a path can be made
+                           // of any number of them
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,6 +32,7 @@
 class DirectoryEntry {
    public:
     bool inUse;                     // Is this directory entry in use?
+    bool isDirectory;               // Is the file a directory itself?
     int sector;                     // Location on disk to find the
                                     //   FileHeader for this file
     char name[FileNameMaxLen + 1];  // Text name for file, with +1 for
@@ -41,8 +42,15 @@ class DirectoryEntry {
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
+// The entries form a hash table, keyed by file name, so that finding
+// a name takes about the same time however many files there are.
+// Collisions are resolved by linear probing.  The table is never more
+// than 3/4 full; when it would be, the directory has to be given a
+// bigger one (see Resize).
+//
 // The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
+// When it is on disk, it is stored as a regular Nachos file, the table
+// just as it is in memory.
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
@@ -60,24 +68,35 @@ class Directory {
 
     int Find(char *name);  // Find the sector number of the
                            // FileHeader for file: "name"
+    bool IsDirectory(char *name);  // Is "name" a subdirectory?
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDirectory);
+    // Add a file name into the directory
 
     bool Remove(char *name);  // Remove a file from the directory
 
-    void List();   // Print the names of all the files
-                   //  in the directory
+    bool IsFull();          // Is there no room for another name?
+    bool IsEmpty();         // Are there no names at all?
+    int TableSize();        // How many entries the table has
+    void Resize(int size);  // Move the names into a table of
+                            // "size" entries
+
+    void List(const char *path);  // Print the names of all the files
+                                  //  in the directory, and under it
     void Print();  // Verbose print of the contents
                    //  of the directory -- all the file
                    //  names and their contents.
 
    private:
     int tableSize;          // Number of directory entries
+    int numUsed;            // Number of them in use
     DirectoryEntry *table;  // Table of pairs:
                             // <file name, file header location>
 
     int FindIndex(char *name);  // Find the index into the directory
                                 //  table corresponding to "name"
+    int Home(char *name);       // Where "name" goes if there is
+                                //  no collision
 };
 
 #endif  // DIRECTORY_H
@@ -3,12 +3,12 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector,
+//	file's data is stored.  We implement this as a list of extents
+//	-- each entry in the list is a run of consecutive disk sectors
+//	holding that portion of the file data.  The first few extents
+//	are in the file header itself, which is just big enough to fit
+//	in one disk sector; the rest are in indirect blocks, found either
+//	through the file header or through a doubly indirect block.
 //
 //      Unlike in a real system, we do not keep track of file permissions,
 //	ownership, last modification date, etc., in the file header.
@@ -18,16 +18,98 @@
 //	     to point to the newly allocated data blocks
 //	   for a file already on disk, by reading the file header from disk
 //
+//	The file headers of open files are kept in a table, so that a
+//	file opened more than once has a single header in memory.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "filehdr.h"
 
+#include "buffercache.h"
 #include "copyright.h"
 #include "debug.h"
 #include "main.h"
-#include "synchdisk.h"
+
+// How a file header is laid out in its sector on disk
+
+class DiskFileHeader {
+   public:
+    int numBytes;
+    int numSectors;
+    int numExtents;
+    int indirect;
+    int doubleIndirect;
+    Extent direct[NumDirect];
+};
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize an empty file header, to be filled in by Allocate or
+//	FetchFrom.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader() {
+    ASSERT(sizeof(DiskFileHeader) <= SectorSize);
+    extents = NULL;
+    firstSector = NULL;
+    moreIndirect = NULL;
+    Empty();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::~FileHeader
+// 	De-allocate the in-memory copy of a file header.
+//----------------------------------------------------------------------
+
+FileHeader::~FileHeader() {
+    Empty();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Empty
+// 	Forget about any extents, leaving an empty file.
+//----------------------------------------------------------------------
+
+void FileHeader::Empty() {
+    delete[] extents;
+    delete[] firstSector;
+    delete[] moreIndirect;
+    extents = NULL;
+    firstSector = NULL;
+    moreIndirect = NULL;
+    numBytes = numSectors = numExtents = 0;
+    indirect = doubleIndirect = -1;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::NumMoreIndirect
+// 	Return how many indirect blocks the doubly indirect block lists.
+//----------------------------------------------------------------------
+
+int FileHeader::NumMoreIndirect() {
+    int beyond = numExtents - NumDirect - ExtentsPerSector;
+
+    return (beyond > 0) ? divRoundUp(beyond, ExtentsPerSector) : 0;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::IndexExtents
+// 	Work out where in the file each extent starts, for ByteToRun.
+//----------------------------------------------------------------------
+
+void FileHeader::IndexExtents() {
+    int sector = 0;
+
+    delete[] firstSector;
+    firstSector = new int[numExtents];
+    for (int i = 0; i < numExtents; i++) {
+        firstSector[i] = sector;
+        sector += extents[i].length;
+    }
+    ASSERT(sector == numSectors);
+}
 
 //----------------------------------------------------------------------
 // FileHeader::Allocate
@@ -36,59 +118,231 @@
 //	Return FALSE if there are not enough free blocks to accomodate
 //	the new file.
 //
+//	The blocks are taken a run at a time: the first run of free
+//	sectors long enough for the rest of the file, or if there is
+//	none, the longest run there is.  So a file gets as few extents
+//	as can be managed, and indirect blocks are only needed once the
+//	disk is badly fragmented.
+//
+//	Once a run comes back shorter than asked for, no run left on the
+//	disk is any longer, so later runs are asked for at that length;
+//	on a fragmented disk they are then found near the front of the
+//	bitmap, rather than after searching all of it for nothing.
+//
 //	"freeMap" is the bit map of free disk sectors
 //	"fileSize" is the bit map of free disk sectors
 //----------------------------------------------------------------------
 
 bool FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize) {
+    Extent *runs;
+    int done, start, count, wanted, longest, i;
+    bool ok;
+
+    Empty();
     numBytes = fileSize;
     numSectors = divRoundUp(fileSize, SectorSize);
     if (freeMap->NumClear() < numSectors)
         return FALSE;  // not enough space
 
-    for (int i = 0; i < numSectors; i++) {
-        dataSectors[i] = freeMap->FindAndSet();
+    runs = new Extent[MaxExtents + 1];
+    longest = numSectors;  // no run we'd want is longer
+    for (done = 0; done < numSectors && numExtents <= MaxExtents; done += count) {
+        wanted = min(numSectors - done, longest);
+        start = freeMap->FindAndSetRun(wanted, &count);
         // since we checked that there was enough free space,
         // we expect this to succeed
-        ASSERT(dataSectors[i] >= 0);
+        ASSERT(start >= 0);
+        if (count < wanted) {
+            longest = count;
+        }
+        if (numExtents > 0 &&
+            runs[numExtents - 1].start + runs[numExtents - 1].length == start) {
+            runs[numExtents - 1].length += count;
+        } else {
+            runs[numExtents].start = start;
+            runs[numExtents].length = count;
+            numExtents++;
+        }
+    }
+    extents = new Extent[numExtents];
+    for (i = 0; i < numExtents; i++) {
+        extents[i] = runs[i];
     }
-    return TRUE;
+    delete[] runs;
+    numSectors = done;  // all of them, unless there were too many extents
+
+    // then sectors for the indirect blocks, if the extents need them
+    ok = (numExtents <= MaxExtents);  // else the disk is too fragmented
+    if (ok && numExtents > NumDirect) {
+        indirect = freeMap->FindAndSet();
+        ok = (indirect >= 0);
+    }
+    if (ok && NumMoreIndirect() > 0) {
+        doubleIndirect = freeMap->FindAndSet();
+        ok = (doubleIndirect >= 0);
+        moreIndirect = new int[NumMoreIndirect()];
+        for (i = 0; i < NumMoreIndirect(); i++) {
+            moreIndirect[i] = freeMap->FindAndSet();
+            ok = ok && (moreIndirect[i] >= 0);
+        }
+    }
+    IndexExtents();
+    if (!ok) {
+        Deallocate(freeMap);  // give back what we got
+    }
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// FreeSector
+// 	Give back a sector of a file being deallocated.
+//----------------------------------------------------------------------
+
+static void
+FreeSector(PersistentBitmap *freeMap, int sector) {
+    ASSERT(freeMap->Test(sector));  // ought to be marked!
+    freeMap->Clear(sector);
+    kernel->bufferCache->Discard(sector);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for its indirect blocks.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
 
 void FileHeader::Deallocate(PersistentBitmap *freeMap) {
-    for (int i = 0; i < numSectors; i++) {
-        ASSERT(freeMap->Test((int)dataSectors[i]));  // ought to be marked!
-        freeMap->Clear((int)dataSectors[i]);
+    int i, j;
+
+    for (i = 0; i < numExtents; i++) {
+        for (j = 0; j < extents[i].length; j++) {
+            FreeSector(freeMap, extents[i].start + j);
+        }
+    }
+    if (indirect >= 0) {
+        FreeSector(freeMap, indirect);
+    }
+    if (doubleIndirect >= 0) {
+        FreeSector(freeMap, doubleIndirect);
+    }
+    if (moreIndirect != NULL) {
+        for (i = 0; i < NumMoreIndirect(); i++) {
+            if (moreIndirect[i] >= 0) {  // Allocate may have run short
+                FreeSector(freeMap, moreIndirect[i]);
+            }
+        }
     }
 }
 
+//----------------------------------------------------------------------
+// FileHeader::ReadExtents
+// FileHeader::WriteExtents
+// 	Read/write some of the extents from/to an indirect block.
+//
+//	"sector" is the indirect block
+//	"into"/"from" is where the extents go/come from
+//	"count" is how many of them; at most ExtentsPerSector
+//----------------------------------------------------------------------
+
+void FileHeader::ReadExtents(int sector, Extent *into, int count) {
+    ASSERT(count > 0 && count <= ExtentsPerSector);
+    kernel->bufferCache->Read(sector, (char *)into, 0, count * sizeof(Extent));
+}
+
+void FileHeader::WriteExtents(int sector, Extent *from, int count) {
+    Extent block[ExtentsPerSector];
+
+    ASSERT(count > 0 && count <= ExtentsPerSector);
+    bzero(block, sizeof(block));
+    bcopy(from, block, count * sizeof(Extent));
+    kernel->bufferCache->WriteSector(sector, (char *)block);
+}
+
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk.
+// 	Fetch contents of file header from disk, along with any indirect
+//	blocks.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
 
 void FileHeader::FetchFrom(int sector) {
-    kernel->synchDisk->ReadSector(sector, (char *)this);
+    int buffer[SectorSize / sizeof(int)];
+    DiskFileHeader *image = (DiskFileHeader *)buffer;
+    int done, i;
+
+    Empty();
+    kernel->bufferCache->ReadSector(sector, (char *)buffer);
+    numBytes = image->numBytes;
+    numSectors = image->numSectors;
+    numExtents = image->numExtents;
+    indirect = image->indirect;
+    doubleIndirect = image->doubleIndirect;
+    ASSERT(numExtents >= 0 && numExtents <= MaxExtents);
+
+    extents = new Extent[numExtents];
+    done = min(numExtents, NumDirect);
+    for (i = 0; i < done; i++) {
+        extents[i] = image->direct[i];
+    }
+    if (indirect >= 0) {
+        ReadExtents(indirect, &extents[done], min(numExtents - done, ExtentsPerSector));
+        done += min(numExtents - done, ExtentsPerSector);
+    }
+    if (doubleIndirect >= 0) {
+        moreIndirect = new int[NumMoreIndirect()];
+        kernel->bufferCache->Read(doubleIndirect, (char *)moreIndirect, 0,
+                                  NumMoreIndirect() * sizeof(int));
+        for (i = 0; i < NumMoreIndirect(); i++) {
+            ReadExtents(moreIndirect[i], &extents[done], min(numExtents - done, ExtentsPerSector));
+            done += min(numExtents - done, ExtentsPerSector);
+        }
+    }
+    ASSERT(done == numExtents);
+    IndexExtents();
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk.
+// 	Write the modified contents of the file header back to disk,
+//	along with any indirect blocks.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
 
 void FileHeader::WriteBack(int sector) {
-    kernel->synchDisk->WriteSector(sector, (char *)this);
+    int buffer[SectorSize / sizeof(int)];
+    DiskFileHeader *image = (DiskFileHeader *)buffer;
+    int done, i;
+
+    bzero(buffer, sizeof(buffer));
+    image->numBytes = numBytes;
+    image->numSectors = numSectors;
+    image->numExtents = numExtents;
+    image->indirect = indirect;
+    image->doubleIndirect = doubleIndirect;
+    done = min(numExtents, NumDirect);
+    for (i = 0; i < done; i++) {
+        image->direct[i] = extents[i];
+    }
+    kernel->bufferCache->WriteSector(sector, (char *)buffer);
+
+    if (indirect >= 0) {
+        WriteExtents(indirect, &extents[done], min(numExtents - done, ExtentsPerSector));
+        done += min(numExtents - done, ExtentsPerSector);
+    }
+    if (doubleIndirect >= 0) {
+        bzero(buffer, sizeof(buffer));
+        bcopy(moreIndirect, buffer, NumMoreIndirect() * sizeof(int));
+        kernel->bufferCache->WriteSector(doubleIndirect, (char *)buffer);
+        for (i = 0; i < NumMoreIndirect(); i++) {
+            WriteExtents(moreIndirect[i], &extents[done], min(numExtents - done, ExtentsPerSector));
+            done += min(numExtents - done, ExtentsPerSector);
+        }
+    }
+    ASSERT(done == numExtents);
 }
 
 //----------------------------------------------------------------------
@@ -102,7 +356,41 @@ void FileHeader::WriteBack(int sector) {
 //----------------------------------------------------------------------
 
 int FileHeader::ByteToSector(int offset) {
-    return (dataSectors[offset / SectorSize]);
+    int runLength;
+
+    return ByteToRun(offset, &runLength);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ByteToRun
+// 	Return which disk sector is storing a particular byte within the
+//	file, like ByteToSector, and how many of the file's sectors from
+//	that one on are next to each other on disk: a read or write of
+//	that many sectors can be done with one disk request.
+//
+//	The extent holding the byte is found by binary search.
+//
+//	"offset" is the location within the file of the byte in question
+//	"runLength" is where to store the number of sectors in the run
+//----------------------------------------------------------------------
+
+int FileHeader::ByteToRun(int offset, int *runLength) {
+    int sector = offset / SectorSize;
+    int low = 0, high = numExtents - 1;
+
+    ASSERT(sector >= 0 && sector < numSectors);
+    while (low < high) {  // the last extent starting at or before sector
+        int middle = (low + high + 1) / 2;
+
+        if (firstSector[middle] <= sector) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    sector -= firstSector[low];
+    *runLength = extents[low].length - sector;
+    return extents[low].start + sector;
 }
 
 //----------------------------------------------------------------------
@@ -125,11 +413,11 @@ void FileHeader::Print() {
     char *data = new char[SectorSize];
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-        printf("%d ", dataSectors[i]);
+    for (i = 0; i < numExtents; i++)
+        printf("%d-%d ", extents[i].start, extents[i].start + extents[i].length - 1);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-        kernel->synchDisk->ReadSector(dataSectors[i], data);
+        kernel->bufferCache->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
             if ('\040' <= data[j] && data[j] <= '\176')  // isprint(data[j])
                 printf("%c", data[j]);
@@ -140,3 +428,151 @@ void FileHeader::Print() {
     }
     delete[] data;
 }
+
+//----------------------------------------------------------------------
+// FileHeaderTable::FileHeaderTable
+// 	Initialize an empty table of file headers, with room for one in
+//	each disk sector.
+//----------------------------------------------------------------------
+
+FileHeaderTable::FileHeaderTable() {
+    headers = new FileHeader *[NumSectors];
+    useCount = new int[NumSectors];
+    newer = new int[NumSectors];
+    older = new int[NumSectors];
+    for (int i = 0; i < NumSectors; i++) {
+        headers[i] = NULL;
+        useCount[i] = 0;
+    }
+    mostRecent = leastRecent = -1;
+    numUnused = 0;
+}
+
+//----------------------------------------------------------------------
+// FileHeaderTable::~FileHeaderTable
+// 	De-allocate the table, along with the headers in it.
+//----------------------------------------------------------------------
+
+FileHeaderTable::~FileHeaderTable() {
+    for (int i = 0; i < NumSectors; i++)
+        delete headers[i];
+    delete[] headers;
+    delete[] useCount;
+    delete[] newer;
+    delete[] older;
+}
+
+//----------------------------------------------------------------------
+// FileHeaderTable::Unlink
+// 	Take a header no open file uses off the list of them.
+//
+//	"sector" -- where the header is stored
+//----------------------------------------------------------------------
+
+void FileHeaderTable::Unlink(int sector) {
+    if (newer[sector] == -1)
+        mostRecent = older[sector];
+    else
+        older[newer[sector]] = older[sector];
+    if (older[sector] == -1)
+        leastRecent = newer[sector];
+    else
+        newer[older[sector]] = newer[sector];
+    numUnused--;
+}
+
+//----------------------------------------------------------------------
+// FileHeaderTable::Open
+// 	Return the file header stored in a sector, for a file being
+//	opened.  If it is not in the table, read it from disk.
+//
+//	Reading it may have to wait for the disk, and in the meantime
+//	another thread may open the same file; if so, its copy is the
+//	one kept.
+//
+//	"sector" -- where the header is stored
+//----------------------------------------------------------------------
+
+FileHeader *
+FileHeaderTable::Open(int sector) {
+    ASSERT(sector >= 0 && sector < NumSectors);
+    if (headers[sector] == NULL) {
+        FileHeader *hdr = new FileHeader;
+
+        DEBUG(dbgFile, "Reading in file header at sector " << sector);
+        hdr->FetchFrom(sector);
+        if (headers[sector] == NULL) {
+            headers[sector] = hdr;
+            useCount[sector] = 1;
+            return hdr;
+        }
+        delete hdr;  // someone else beat us to it
+    }
+    if (useCount[sector] == 0) {
+        Unlink(sector);  // it was on the unused list
+    }
+    useCount[sector]++;
+    return headers[sector];
+}
+
+//----------------------------------------------------------------------
+// FileHeaderTable::Close
+// 	An open file is done with the header stored in a sector.  If no
+//	open file uses it any more, put it at the front of the list of
+//	unused headers, and if there are too many of them, throw away the
+//	one at the back.
+//
+//	"sector" -- where the header is stored
+//----------------------------------------------------------------------
+
+void FileHeaderTable::Close(int sector) {
+    ASSERT(headers[sector] != NULL && useCount[sector] > 0);
+    if (--useCount[sector] > 0)
+        return;
+
+    newer[sector] = -1;
+    older[sector] = mostRecent;
+    if (mostRecent == -1)
+        leastRecent = sector;
+    else
+        newer[mostRecent] = sector;
+    mostRecent = sector;
+    numUnused++;
+
+    if (numUnused > NumCachedHeaders) {
+        int victim = leastRecent;
+
+        Unlink(victim);
+        delete headers[victim];
+        headers[victim] = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeaderTable::IsOpen
+// 	Return TRUE if an open file uses the header stored in a sector.
+//
+//	"sector" -- where the header is stored
+//----------------------------------------------------------------------
+
+bool FileHeaderTable::IsOpen(int sector) {
+    return headers[sector] != NULL && useCount[sector] > 0;
+}
+
+//----------------------------------------------------------------------
+// FileHeaderTable::Forget
+// 	Throw away the copy in memory of the header stored in a sector,
+//	if there is one, because the one on disk has been freed or
+//	replaced.
+//
+//	"sector" -- where the header is stored
+//----------------------------------------------------------------------
+
+void FileHeaderTable::Forget(int sector) {
+    if (headers[sector] == NULL)
+        return;
+    ASSERT(useCount[sector] == 0);
+    Unlink(sector);
+    delete headers[sector];
+    headers[sector] = NULL;
+}
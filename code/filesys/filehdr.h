@@ -17,26 +17,48 @@
 #include "disk.h"
 #include "pbitmap.h"
 
-#define NumDirect ((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize (NumDirect * SectorSize)
+// A run of consecutive disk sectors holding consecutive data of a file
+
+class Extent {
+   public:
+    int start;   // the first sector
+    int length;  // how many sectors
+};
+
+#define NumDirect ((int)((SectorSize - 5 * sizeof(int)) / sizeof(Extent)))
+#define ExtentsPerSector ((int)(SectorSize / sizeof(Extent)))
+#define IndirectPerSector ((int)(SectorSize / sizeof(int)))
+#define MaxExtents (NumDirect + ExtentsPerSector + IndirectPerSector * ExtentsPerSector)
+#define MaxFileSize (NumSectors * SectorSize)
+
+const int NumCachedHeaders = 32;  // file headers kept in memory once
+                                  // no open file uses them
 
 // The following class defines the Nachos "file header" (in UNIX terms,
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks.
+// The file header is organized as a list of extents: runs of sectors
+// that are next to each other on disk.
 //
 // The file header data structure can be stored in memory or on disk.
-// When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// When it is on disk, it is stored in a single sector, which has room
+// for the first NumDirect extents.  The next ExtentsPerSector extents
+// are in an indirect block, and the rest in indirect blocks whose
+// sectors are listed in a doubly indirect block.  Since the free sectors
+// are handed out in runs, a file usually has only a few extents, and
+// it can be as big as the disk.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// In memory, all the extents are kept in one array, along with where
+// in the file each one starts, so that finding the sector holding a
+// byte of the file is a binary search.
+//
+// The file header can be initialized by allocating blocks for the file
+// (if it is a new file), or by reading it from disk.
 
 class FileHeader {
    public:
+    FileHeader();   // An empty file header
+    ~FileHeader();  // De-allocate the in-memory copy
+
     bool Allocate(PersistentBitmap *bitMap, int fileSize);  // Initialize a file header,
                                                             //  including allocating space
                                                             //  on disk for the file data
@@ -50,6 +72,10 @@ class FileHeader {
     int ByteToSector(int offset);  // Convert a byte offset into the file
                                    // to the disk sector containing
                                    // the byte
+    int ByteToRun(int offset, int *runLength);
+    // Same, and also say how many sectors,
+    // from that one on, are next to each
+    // other on disk
 
     int FileLength();  // Return the length of the file
                        // in bytes
@@ -57,10 +83,59 @@ class FileHeader {
     void Print();  // Print the contents of the file.
 
    private:
-    int numBytes;                // Number of bytes in the file
-    int numSectors;              // Number of data sectors in the file
-    int dataSectors[NumDirect];  // Disk sector numbers for each data
-                                 // block in the file
+    int numBytes;        // Number of bytes in the file
+    int numSectors;      // Number of data sectors in the file
+    int numExtents;      // Number of runs the sectors are in
+    int indirect;        // Sector with the extents after the
+                         // direct ones, or -1
+    int doubleIndirect;  // Sector listing the sectors with the
+                         // rest of the extents, or -1
+    int *moreIndirect;   // Those sectors, as listed
+
+    Extent *extents;     // All the extents, in file order
+    int *firstSector;    // Where in the file (in sectors) each
+                         // extent starts
+
+    int NumMoreIndirect();  // How many sectors moreIndirect lists
+    void Empty();           // Forget the extents
+    void IndexExtents();    // Work out firstSector
+    void ReadExtents(int sector, Extent *into, int count);
+    void WriteExtents(int sector, Extent *from, int count);
+    // Read/write part of "extents" from/to an
+    // indirect block
+};
+
+// The following class defines the table of file headers in memory,
+// indexed by the sector each one is stored in.  Every open file with
+// the same header shares one copy of it, which is only read from disk
+// the first time.  Once a header is no longer used, it is kept a while
+// longer, in case the file is opened again; the one closed longest ago
+// makes room when there are more than NumCachedHeaders.
+
+class FileHeaderTable {
+   public:
+    FileHeaderTable();   // An empty table
+    ~FileHeaderTable();  // De-allocate it, and every header in it
+
+    FileHeader *Open(int sector);  // Return the header in "sector",
+                                   // reading it in if it is not here
+    void Close(int sector);        // One fewer open file uses it
+
+    bool IsOpen(int sector);  // Does an open file use the header?
+    void Forget(int sector);  // The header in memory is out of date
+                              // (it was freed, or written anew);
+                              // no open file may be using it
+
+   private:
+    FileHeader **headers;  // the header in each sector, or NULL
+    int *useCount;         // how many open files use each one
+    int *newer;            // the headers no open file uses, from
+    int *older;            // the one closed last (mostRecent) to
+    int mostRecent;        // the one closed first (leastRecent),
+    int leastRecent;       // linked by sector; -1 ends the list
+    int numUnused;         // how many are on the list
+
+    void Unlink(int sector);  // take a header off the list
 };
 
 #endif  // FILEHDR_H
@@ -5,39 +5,49 @@
 //	Each file in the file system has:
 //	   A file header, stored in a sector on disk
 //		(the size of the file header data structure is arranged
-//		to be precisely the size of 1 disk sector)
+//		to be precisely the size of 1 disk sector), and if the
+//		file is in many pieces, indirect blocks listing the rest
 //	   A number of data blocks
-//	   An entry in the file system directory
+//	   An entry in the directory it is in
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A root directory of file names and file headers, some of
+//	     which may be directories in their turn
 //
-//      Both the bitmap and the directory are represented as normal
-//	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them
-//	on bootup.
+//      The bitmap and the directories are represented as normal
+//	files.  The file headers of the bitmap and the root directory
+//	are located in specific sectors (sector 0 and sector 1), so that
+//	the file system can find them on bootup.
 //
-//	The file system assumes that the bitmap and directory files are
-//	kept "open" continuously while Nachos is running.
+//	The file system assumes that the bitmap and root directory files
+//	are kept "open" continuously while Nachos is running.  The bitmap
+//	is also kept in memory, and only the sectors of it that have
+//	changed are written back after each operation.  So are the
+//	other directories used lately, until they make room for others.
+//	A directory in memory is always the same as the one on disk.
+//	The paths of the files opened lately are also remembered, along
+//	with where their file headers are.
 //
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	are written immediately back to the buffer cache, which gets them
+//	to disk later (the two files are kept open during all this time).
+//	If the operation fails, any sectors it took in the bitmap are
+//	given back before it returns, and the directory is left alone.
+//
+//	Each such operation is a transaction of the journal: the cache
+//	keeps what it writes until the journal has logged it all, with
+//	one write, and the log is replayed when Nachos starts up, so an
+//	operation is never left half done on disk.
 //
 // 	Our implementation at this point has the following restrictions:
 //
 //	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	     (except directories, which double in size when they fill up)
+//	   only metadata is journaled: a file's data may be lost if
+//	    Nachos is killed before it has been written back
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -46,24 +56,27 @@
 
 #include "filesys.h"
 
+#include "buffercache.h"
 #include "copyright.h"
 #include "debug.h"
 #include "directory.h"
 #include "disk.h"
 #include "filehdr.h"
+#include "journal.h"
+#include "main.h"
 #include "pbitmap.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known
-// sectors, so that they can be located on boot-up.
+// sectors, so that they can be located on boot-up.  The journal comes
+// next (JournalSector).
 #define FreeMapSector 0
 #define DirectorySector 1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and directories; a directory is
+// made bigger when it fills up.
 #define FreeMapFileSize (NumSectors / BitsInByte)
-#define NumDirEntries 10
+#define NumDirEntries 16
 #define DirectoryFileSize (sizeof(DirectoryEntry) * NumDirEntries)
 
 //----------------------------------------------------------------------
@@ -73,26 +86,41 @@
 //	an empty directory, and a bitmap of free sectors (with almost but
 //	not all of the sectors marked as free).
 //
-//	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format = FALSE, we just have to replay the journal, and open
+//	the files representing the bitmap and the directory.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
 
 FileSystem::FileSystem(bool format) {
     DEBUG(dbgFile, "Initializing the file system.");
+    for (int i = 0; i < NumCachedDirs; i++) {
+        dirs[i] = NULL;
+        dirFiles[i] = NULL;
+        dirSectors[i] = -1;
+        dirLastUse[i] = 0;
+    }
+    dirUses = 0;
+    for (int i = 0; i < NumCachedNames; i++) {
+        cachedNames[i] = NULL;
+    }
+    journal = new Journal();
     if (format) {
-        PersistentBitmap *freeMap = new PersistentBitmap(NumSectors);
+        freeMap = new PersistentBitmap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
         FileHeader *mapHdr = new FileHeader;
         FileHeader *dirHdr = new FileHeader;
 
         DEBUG(dbgFile, "Formatting the file system.");
 
-        // First, allocate space for FileHeaders for the directory and bitmap
-        // (make sure no one else grabs these!)
+        // First, allocate space for FileHeaders for the directory and bitmap,
+        // and for the journal (make sure no one else grabs these!)
         freeMap->Mark(FreeMapSector);
         freeMap->Mark(DirectorySector);
+        for (int i = 0; i < NumJournalSectors; i++) {
+            freeMap->Mark(JournalSector + i);
+        }
+        journal->Format();
 
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
@@ -114,7 +142,7 @@ FileSystem::FileSystem(bool format) {
         // while Nachos is running.
 
         freeMapFile = new OpenFile(FreeMapSector);
-        directoryFile = new OpenFile(DirectorySector);
+        dirFiles[0] = new OpenFile(DirectorySector);
 
         // Once we have the files "open", we can write the initial version
         // of each file back to disk.  The directory at this point is completely
@@ -124,180 +152,459 @@ FileSystem::FileSystem(bool format) {
 
         DEBUG(dbgFile, "Writing bitmap and directory back to disk.");
         freeMap->WriteBack(freeMapFile);  // flush changes to disk
-        directory->WriteBack(directoryFile);
+        directory->WriteBack(dirFiles[0]);
 
         if (debug->IsEnabled('f')) {
             freeMap->Print();
             directory->Print();
         }
-        delete freeMap;
-        delete directory;
         delete mapHdr;
         delete dirHdr;
+        dirs[0] = directory;
+        kernel->bufferCache->Sync();  // the journal only covers changes
+                                      // made from here on
     } else {
-        // if we are not formatting the disk, just open the files representing
-        // the bitmap and directory; these are left open while Nachos is running
+        // if we are not formatting the disk, finish what the journal says
+        // was committed, then open the files representing the bitmap and
+        // directory; these are left open while Nachos is running
+        journal->Replay();
         freeMapFile = new OpenFile(FreeMapSector);
-        directoryFile = new OpenFile(DirectorySector);
+        freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+        dirFiles[0] = new OpenFile(DirectorySector);
+        dirs[0] = new Directory(0);
+        dirs[0]->FetchFrom(dirFiles[0]);
+    }
+    dirSectors[0] = DirectorySector;
+    kernel->bufferCache->SetJournal(journal);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Close the bitmap file, and the directories in the cache.  They
+//	are all on disk already.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem() {
+    for (int i = 0; i < NumCachedDirs; i++) {
+        delete dirs[i];
+        delete dirFiles[i];
+    }
+    for (int i = 0; i < NumCachedNames; i++) {
+        delete[] cachedNames[i];
+    }
+    delete freeMap;
+    delete freeMapFile;
+    delete journal;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::GetDirectory
+// 	Return the slot of the directory cache holding the directory
+//	whose file header is in "sector".  If it is not there, read it
+//	in, in place of the one used least recently (never the root).
+//
+//	"sector" -- where the directory's file header is
+//----------------------------------------------------------------------
+
+int FileSystem::GetDirectory(int sector) {
+    int slot = -1;
+
+    dirUses++;
+    for (int i = 0; i < NumCachedDirs; i++) {
+        if (dirSectors[i] == sector) {
+            dirLastUse[i] = dirUses;
+            return i;
+        }
+        if (i > 0 && (slot == -1 || dirLastUse[i] < dirLastUse[slot]))
+            slot = i;
+    }
+    DEBUG(dbgFile, "Reading in directory at sector " << sector);
+    delete dirs[slot];  // nothing to write back
+    delete dirFiles[slot];
+    dirFiles[slot] = new OpenFile(sector);
+    dirs[slot] = new Directory(0);
+    dirs[slot]->FetchFrom(dirFiles[slot]);
+    dirSectors[slot] = sector;
+    dirLastUse[slot] = dirUses;
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ForgetDirectory
+// 	Drop a directory that is being removed from the cache, if it is
+//	there.
+//
+//	"sector" -- where the directory's file header was
+//----------------------------------------------------------------------
+
+void FileSystem::ForgetDirectory(int sector) {
+    for (int i = 1; i < NumCachedDirs; i++)
+        if (dirSectors[i] == sector) {
+            delete dirs[i];
+            delete dirFiles[i];
+            dirs[i] = NULL;
+            dirFiles[i] = NULL;
+            dirSectors[i] = -1;
+            dirLastUse[i] = 0;
+        }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindParent
+// 	Walk a path, such as "/a/b/c", from the root directory to the
+//	directory its last name is in (here "/a/b").  The leading '/'
+//	may be left out.
+//
+//	Return the sector of that directory's file header, or -1 if
+//	one of the names before the last is not a directory, or if any
+//	name is empty or too long.
+//
+//	"path" -- the path to walk
+//	"name" -- where to put the last name in the path; it has room
+//		for FileNameMaxLen + 1 characters
+//----------------------------------------------------------------------
+
+int FileSystem::FindParent(char *path, char *name) {
+    int sector = DirectorySector;
+    int len;
+
+    if (*path == '/')
+        path++;
+    for (;;) {
+        for (len = 0; path[len] != '\0' && path[len] != '/'; len++)
+            ;
+        if (len == 0 || len > FileNameMaxLen)
+            return -1;
+        strncpy(name, path, len);
+        name[len] = '\0';
+        if (path[len] == '\0')
+            return sector;  // it was the last name
+
+        Directory *directory = dirs[GetDirectory(sector)];
+        if (!directory->IsDirectory(name))
+            return -1;
+        sector = directory->Find(name);
+        path += len + 1;
     }
 }
 
+//----------------------------------------------------------------------
+// FileSystem::AddEntry
+// 	Add a name to a directory in the cache.  If the directory is
+//	full, it is first moved to a file twice as big: the new space
+//	is allocated, the old space is freed, and the new file header
+//	replaces the old one, in the same sector.
+//
+//	Return FALSE, with nothing changed, if there is no room on disk
+//	to make the directory bigger.  The caller writes the directory
+//	and the bitmap back.
+//
+//	"slot" -- which directory in the cache
+//	"name", "sector", "isDirectory" -- the entry to add
+//----------------------------------------------------------------------
+
+bool FileSystem::AddEntry(int slot, char *name, int sector, bool isDirectory) {
+    Directory *directory = dirs[slot];
+
+    if (directory->IsFull()) {
+        int newSize = 2 * directory->TableSize();
+        FileHeader *oldHdr = new FileHeader;
+        FileHeader *newHdr = new FileHeader;
+
+        DEBUG(dbgFile, "Growing directory at sector " << dirSectors[slot]
+              << " to " << newSize << " entries");
+        if (!newHdr->Allocate(freeMap, newSize * sizeof(DirectoryEntry))) {
+            delete oldHdr;
+            delete newHdr;
+            return FALSE;  // no space on disk
+        }
+        oldHdr->FetchFrom(dirSectors[slot]);
+        oldHdr->Deallocate(freeMap);
+        delete dirFiles[slot];
+        newHdr->WriteBack(dirSectors[slot]);
+        kernel->fileHeaders->Forget(dirSectors[slot]);
+        delete oldHdr;
+        delete newHdr;
+
+        dirFiles[slot] = new OpenFile(dirSectors[slot]);
+        directory->Resize(newSize);
+    }
+    ASSERT(directory->Add(name, sector, isDirectory));
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
 //	Since we can't increase the size of files dynamically, we have
 //	to give Create the initial size of the file.
 //
+//	"name" -- path of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool FileSystem::Create(char *name, int initialSize) {
+    bool success;
+
+    DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
+    journal->Begin();
+    success = CreateEntry(name, initialSize, FALSE);
+    journal->End();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateDirectory
+// 	Create an empty directory in the Nachos file system (similar to
+//	UNIX mkdir).
+//
+//	"name" -- path of directory to be created
+//----------------------------------------------------------------------
+
+bool FileSystem::CreateDirectory(char *name) {
+    bool success;
+
+    DEBUG(dbgFile, "Creating directory " << name);
+    journal->Begin();
+    success = CreateEntry(name, DirectoryFileSize, TRUE);
+    journal->End();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateEntry
+// 	Create a file or a directory.
+//
 //	The steps to create a file are:
+//	  Find the directory it goes in
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
-//	  Add the name to the directory
+//	  Add the name to the directory, making the directory bigger
+//	    if it is full
 //	  Store the new file header on disk
 //	  Flush the changes to the bitmap and the directory back to disk
+//	A new directory is also given an empty table.
 //
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		the directory it goes in does not exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file
+//		no free space to make the directory bigger
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
+// 	The caller has begun a journal transaction, so no other thread
+//	creates or removes anything until it ends.
 //
-//	"name" -- name of file to be created
+//	"path" -- path of file to be created
 //	"initialSize" -- size of file to be created
+//	"isDirectory" -- is it to be a directory?
 //----------------------------------------------------------------------
 
-bool FileSystem::Create(char *name, int initialSize) {
-    Directory *directory;
-    PersistentBitmap *freeMap;
+bool FileSystem::CreateEntry(char *path, int initialSize, bool isDirectory) {
+    char name[FileNameMaxLen + 1];
+    int parent, slot;
     FileHeader *hdr;
     int sector;
     bool success;
 
-    DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
-
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+    parent = FindParent(path, name);
+    if (parent == -1)
+        return FALSE;  // no such directory
+    slot = GetDirectory(parent);
+    if (dirs[slot]->Find(name) != -1)
+        return FALSE;  // file is already in directory
 
-    if (directory->Find(name) != -1)
-        success = FALSE;  // file is already in directory
+    sector = freeMap->FindAndSet();  // find a sector to hold the file header
+    if (sector == -1)
+        success = FALSE;  // no free block for file header
     else {
-        freeMap = new PersistentBitmap(freeMapFile, NumSectors);
-        sector = freeMap->FindAndSet();  // find a sector to hold the file header
-        if (sector == -1)
-            success = FALSE;  // no free block for file header
-        else if (!directory->Add(name, sector))
-            success = FALSE;  // no space in directory
-        else {
-            hdr = new FileHeader;
-            if (!hdr->Allocate(freeMap, initialSize))
-                success = FALSE;  // no space on disk for data
-            else {
-                success = TRUE;
-                // everthing worked, flush all changes back to disk
-                hdr->WriteBack(sector);
-                directory->WriteBack(directoryFile);
-                freeMap->WriteBack(freeMapFile);
+        hdr = new FileHeader;
+        if (!hdr->Allocate(freeMap, initialSize)) {
+            success = FALSE;  // no space on disk for data
+            freeMap->Clear(sector);
+        } else if (!AddEntry(slot, name, sector, isDirectory)) {
+            success = FALSE;  // no space to grow the directory
+            hdr->Deallocate(freeMap);
+            freeMap->Clear(sector);
+        } else {
+            success = TRUE;
+            // everthing worked, flush all changes back to disk
+            hdr->WriteBack(sector);
+            if (isDirectory) {
+                Directory *directory = new Directory(NumDirEntries);
+                OpenFile *file = new OpenFile(sector);
+
+                directory->WriteBack(file);
+                delete file;
+                delete directory;
             }
-            delete hdr;
+            dirs[slot]->WriteBack(dirFiles[slot]);
+            freeMap->WriteBack(freeMapFile);
         }
-        delete freeMap;
+        delete hdr;
     }
-    delete directory;
     return success;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::NameSlot
+// 	Return the slot of the file name cache a path goes in, by its
+//	FNV-1a hash.
+//
+//	"path" -- the path, without the leading '/'
+//----------------------------------------------------------------------
+
+int FileSystem::NameSlot(char *path) {
+    unsigned int hash = 2166136261u;
+
+    for (; *path != '\0'; path++) {
+        hash = (hash ^ (unsigned char)*path) * 16777619u;
+    }
+    return hash % NumCachedNames;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Open
 // 	Open a file for reading and writing.
 //	To open a file:
-//	  Find the location of the file's header, using the directory
-//	  Bring the header into memory
+//	  Find the location of the file's header, in the file name
+//	    cache, or else using the directories along its path
+//	  Bring the header into memory, unless another open of the
+//	    file (or a recent one) has it there already
+//	Directories can't be opened.
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name) {
-    Directory *directory = new Directory(NumDirEntries);
-    OpenFile *openFile = NULL;
-    int sector;
+    char last[FileNameMaxLen + 1];
+    char *path = (*name == '/') ? name + 1 : name;
+    int nameSlot = NameSlot(path);
+    Directory *directory;
+    int parent, sector;
 
     DEBUG(dbgFile, "Opening file" << name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector >= 0)
-        openFile = new OpenFile(sector);  // name was found in directory
-    delete directory;
-    return openFile;  // return NULL if not found
+    if (cachedNames[nameSlot] != NULL && !strcmp(cachedNames[nameSlot], path))
+        return new OpenFile(cachedSectors[nameSlot]);
+
+    parent = FindParent(name, last);
+    if (parent == -1)
+        return NULL;  // no such directory
+    directory = dirs[GetDirectory(parent)];
+    sector = directory->Find(last);
+    if (sector == -1 || directory->IsDirectory(last))
+        return NULL;  // not found, or not a file
+
+    delete[] cachedNames[nameSlot];
+    cachedNames[nameSlot] = new char[strlen(path) + 1];
+    strcpy(cachedNames[nameSlot], path);
+    cachedSectors[nameSlot] = sector;
+    return new OpenFile(sector);  // name was found in directory
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
-// 	Delete a file from the file system.  This requires:
+// 	Delete a file, or an empty directory, from the file system.
+//	This requires:
 //	    Remove it from the directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
+//	    Forget its path and header in memory
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, is open, or is a directory with something
+//	in it.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path of the file to be removed
 //----------------------------------------------------------------------
 
 bool FileSystem::Remove(char *name) {
-    Directory *directory;
-    PersistentBitmap *freeMap;
-    FileHeader *fileHdr;
-    int sector;
+    bool success;
+
+    journal->Begin();
+    success = RemoveEntry(name);
+    journal->End();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::RemoveEntry
+// 	Do the work of Remove, inside a journal transaction.
+//
+//	"name" -- the path of the file to be removed
+//----------------------------------------------------------------------
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
-        delete directory;
+bool FileSystem::RemoveEntry(char *name) {
+    char last[FileNameMaxLen + 1];
+    char *path = (*name == '/') ? name + 1 : name;
+    int nameSlot = NameSlot(path);
+    FileHeader *fileHdr;
+    int parent, slot, sector;
+
+    parent = FindParent(name, last);
+    if (parent == -1)
+        return FALSE;  // no such directory
+    slot = GetDirectory(parent);
+    sector = dirs[slot]->Find(last);
+    if (sector == -1)
         return FALSE;  // file not found
+    if (dirs[slot]->IsDirectory(last)) {
+        if (!dirs[GetDirectory(sector)]->IsEmpty())
+            return FALSE;  // directory not empty
+        ForgetDirectory(sector);
+        slot = GetDirectory(parent);  // may have been pushed out
     }
+    if (kernel->fileHeaders->IsOpen(sector))
+        return FALSE;  // file is open
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
 
-    freeMap = new PersistentBitmap(freeMapFile, NumSectors);
-
     fileHdr->Deallocate(freeMap);  // remove data blocks
     freeMap->Clear(sector);        // remove header block
-    directory->Remove(name);
+    kernel->bufferCache->Discard(sector);
+    kernel->fileHeaders->Forget(sector);
+    dirs[slot]->Remove(last);
+    if (cachedNames[nameSlot] != NULL && !strcmp(cachedNames[nameSlot], path)) {
+        delete[] cachedNames[nameSlot];
+        cachedNames[nameSlot] = NULL;
+    }
 
-    freeMap->WriteBack(freeMapFile);      // flush to disk
-    directory->WriteBack(directoryFile);  // flush to disk
+    freeMap->WriteBack(freeMapFile);           // flush to disk
+    dirs[slot]->WriteBack(dirFiles[slot]);     // flush to disk
     delete fileHdr;
-    delete directory;
-    delete freeMap;
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Write every change to the file system back to its place on disk,
+//	and empty the journal, so that the next time Nachos starts up
+//	there is nothing to replay.  Called when Nachos halts.
+//----------------------------------------------------------------------
+
+void FileSystem::Sync() {
+    journal->Checkpoint();
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the file system, with their paths.
 //----------------------------------------------------------------------
 
 void FileSystem::List() {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
-    directory->List();
-    delete directory;
+    dirs[0]->List("/");
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Print
 // 	Print everything about the file system:
 //	  the contents of the bitmap
-//	  the contents of the directory
+//	  the contents of the root directory
 //	  for each file in the directory,
 //	      the contents of the file header
 //	      the data in the file
@@ -306,8 +613,6 @@ void FileSystem::List() {
 void FileSystem::Print() {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
 
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
@@ -319,13 +624,10 @@ void FileSystem::Print() {
 
     freeMap->Print();
 
-    directory->FetchFrom(directoryFile);
-    directory->Print();
+    dirs[0]->Print();
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
-    delete directory;
 }
 
 #endif  // FILESYS_STUB
@@ -18,14 +18,24 @@
 //	file system (in a file named "DISK").
 //
 //	In the "real" implementation, there are two key data structures used
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.
+//	in the file system.  There is a "root" directory, listing the files
+//	and directories at the top of the file system; as in UNIX, each
+//	directory can list further directories, and a file is named by
+//	its path from the root, with the names separated by '/'.
 //	In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
 //	bootstrap problem when the simulated disk is initialized.
 //
+//	Changes to the file system are journaled: each operation's
+//	changes reach the disk together or not at all, even if Nachos is
+//	killed in the middle (see journal.h).
+//
+//	The directories used most recently are kept in memory, so that
+//	walking a path does not read the same directories from disk
+//	again and again; so is where the files opened lately are, so
+//	that opening one of them again does not walk its path at all.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
@@ -108,7 +118,8 @@ class FileSystem {
         if (openFileObj == NULL) return -1; // 找不到檔案
         delete openFileObj;  // 刪除open時new出來的物件
         OpenFileTable[id] = NULL;
-        OpenFileNameTable[id] == NULL;
+        delete[] OpenFileNameTable[id];  // 檔名是 open 時複製的
+        OpenFileNameTable[id] = NULL;
         return 1;
     }
 
@@ -119,6 +130,15 @@ class FileSystem {
 };
 
 #else  // FILESYS
+class Directory;
+class Journal;
+class PersistentBitmap;
+
+const int NumCachedDirs = 8;    // directories kept in memory, the
+                                // root among them
+const int NumCachedNames = 64;  // paths of files opened lately
+                                // kept in memory
+
 class FileSystem {
    public:
     FileSystem(bool format);  // Initialize the file system.
@@ -127,23 +147,61 @@ class FileSystem {
                               // If "format", there is nothing on
                               // the disk, so initialize the directory
                               // and the bitmap of free blocks.
+    ~FileSystem();            // Forget the cached directories
 
     bool Create(char *name, int initialSize);
     // Create a file (UNIX creat)
 
+    bool CreateDirectory(char *name);  // Create a directory (UNIX mkdir)
+
     OpenFile *Open(char *name);  // Open a file (UNIX open)
 
-    bool Remove(char *name);  // Delete a file (UNIX unlink)
+    bool Remove(char *name);  // Delete a file, or an empty
+                              // directory (UNIX unlink, rmdir)
 
     void List();  // List all the files in the file system
 
     void Print();  // List all the files and their contents
 
+    void Sync();  // Write every change back to its place
+                  // on disk, and empty the journal
+
    private:
     OpenFile *freeMapFile;    // Bit map of free disk blocks,
                               // represented as a file
-    OpenFile *directoryFile;  // "Root" directory -- list of
-                              // file names, represented as a file
+    PersistentBitmap *freeMap;  // The same bit map, kept in memory
+    Journal *journal;         // Log of changes to the above, and
+                              // to directories and file headers
+
+    // The cache of directories: slot 0 always has the root
+    // directory, the others the directories used most recently.
+    Directory *dirs[NumCachedDirs];    // the directory, or NULL
+    OpenFile *dirFiles[NumCachedDirs]; // the file it is kept in
+    int dirSectors[NumCachedDirs];     // and that file's header sector
+    int dirLastUse[NumCachedDirs];     // when it was last looked at
+    int dirUses;                       // count of directory look ups
+
+    // The cache of file names: each path goes in the slot its hash
+    // value picks, in place of the one there.
+    char *cachedNames[NumCachedNames]; // a path, without the leading
+                                       // '/', or NULL
+    int cachedSectors[NumCachedNames]; // where its file header is
+
+    int GetDirectory(int sector);     // Which slot has the directory,
+                                      // reading it in if need be
+    void ForgetDirectory(int sector); // Drop it from the cache
+    int FindParent(char *path, char *name);
+    // Walk the path up to its last name,
+    // which is copied into "name"; return
+    // the sector of the directory it is
+    // in, or -1
+    bool AddEntry(int slot, char *name, int sector, bool isDirectory);
+    // Add to a cached directory, making
+    // it bigger if it is full
+    bool CreateEntry(char *path, int initialSize, bool isDirectory);
+    // Create a file or a directory
+    bool RemoveEntry(char *name);  // Remove a file or a directory
+    int NameSlot(char *path);  // Which slot a path goes in
 };
 
 #endif  // FILESYS
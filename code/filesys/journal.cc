@@ -0,0 +1,450 @@
+// journal.cc
+//	Routines to keep a write-ahead journal of file system metadata.
+//
+//	The log takes up NumJournalSectors sectors from JournalSector on.
+//	The first says which transaction the log starts with; after it
+//	come the records of the transactions committed since the last
+//	checkpoint, one after another.  A record is:
+//	   one or more descriptor sectors: a RecordHeader, then the
+//	     numbers of the sectors written, then those of the sectors
+//	     freed (revoked)
+//	   a copy of each sector written, in the same order
+//	It is written with one disk request.  The header has a checksum
+//	of the whole record, so if Nachos is killed while it is being
+//	written, the record is not taken for a committed one.
+//
+//	The transactions are numbered, and a record only counts if it
+//	has the next number after the one before it; so once a
+//	checkpoint has moved the start of the log on, the old records
+//	still on disk are ignored.
+//
+//	A sector freed by a transaction is revoked: any copy of it earlier
+//	in the log is not written back on replay, since it may have been
+//	given to a file since, and its data written straight to disk.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "journal.h"
+
+#include "buffercache.h"
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "synch.h"
+#include "synchdisk.h"
+
+const int JournalMagic = 0x4a726e6c;  // marks the log's sectors
+
+// How the first sector of the log is laid out on disk
+
+class JournalStart {
+   public:
+    int magic;
+    int firstSeq;  // the number of the first record in the log
+};
+
+// How a record starts, in its first descriptor sector
+
+class RecordHeader {
+   public:
+    int magic;
+    int seq;                // the transaction's number
+    int numLogged;          // how many sectors it wrote
+    int numRevoked;         // how many it freed
+    unsigned int checksum;  // of the record, with this field 0
+};
+
+#define DescriptorSectors(numLogged, numRevoked) \
+    divRoundUp(sizeof(RecordHeader) + ((numLogged) + (numRevoked)) * sizeof(int), SectorSize)
+#define MaxRevoked \
+    ((int)((MaxDescriptorSectors * SectorSize - sizeof(RecordHeader)) / sizeof(int)) - MaxTransactionSectors)
+#define FirstRecordSector (JournalSector + 1)
+#define EndOfJournal (JournalSector + NumJournalSectors)
+#define OutsideLog(sector) \
+    ((sector) >= 0 && (sector) < NumSectors && \
+     ((sector) < JournalSector || (sector) >= EndOfJournal))
+
+//----------------------------------------------------------------------
+// Checksum
+// 	Return the FNV-1a hash of a record, to tell a whole one from one
+//	that was only partly written.
+//----------------------------------------------------------------------
+
+static unsigned int
+Checksum(char *data, int numBytes) {
+    unsigned int hash = 2166136261u;
+
+    for (int i = 0; i < numBytes; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the journal; Format or Replay find out where the log
+//	is up to.
+//----------------------------------------------------------------------
+
+Journal::Journal() {
+    ASSERT(sizeof(JournalStart) <= SectorSize);
+    ASSERT(sizeof(RecordHeader) <= SectorSize);
+    head = FirstRecordSector;
+    nextSeq = 1;
+    open = FALSE;
+    tooBig = FALSE;
+    lock = new Lock("journal");
+    owner = NULL;
+    logged = new int[MaxTransactionSectors];
+    numLogged = 0;
+    revoked = new int[MaxRevoked];
+    numRevoked = 0;
+    inTransaction = new bool[NumSectors];
+    inLog = new bool[NumSectors];
+    for (int i = 0; i < NumSectors; i++) {
+        inTransaction[i] = FALSE;
+        inLog[i] = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the journal.
+//----------------------------------------------------------------------
+
+Journal::~Journal() {
+    delete lock;
+    delete[] logged;
+    delete[] revoked;
+    delete[] inTransaction;
+    delete[] inLog;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteStart
+// 	Write the first sector of the log, saying that the log starts
+//	with the next transaction to commit.
+//----------------------------------------------------------------------
+
+void Journal::WriteStart() {
+    char buffer[SectorSize];
+    JournalStart *start = (JournalStart *)buffer;
+
+    bzero(buffer, sizeof(buffer));
+    start->magic = JournalMagic;
+    start->firstSeq = nextSeq;
+    kernel->synchDisk->WriteSector(JournalSector, buffer);
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Start an empty log, on a disk being formatted.
+//----------------------------------------------------------------------
+
+void Journal::Format() {
+    head = FirstRecordSector;
+    nextSeq = 1;
+    WriteStart();
+}
+
+//----------------------------------------------------------------------
+// Journal::ReadRecord
+// 	Read the record of a transaction from the log.  Return how many
+//	sectors it takes up, or 0 if there is no whole, sensible record
+//	for that transaction there: the log ends before it.
+//
+//	The copies of sectors in the record replace any earlier ones, and
+//	the sectors it revokes lose theirs.
+//
+//	"sector" -- where the record starts
+//	"seq" -- the number of the transaction it has to be
+//	"copies" -- the latest copy of each sector, or NULL
+//----------------------------------------------------------------------
+
+int Journal::ReadRecord(int sector, int seq, char **copies) {
+    char first[SectorSize];
+    RecordHeader *hdr = (RecordHeader *)first;
+    char *buffer;
+    int *sectors;
+    int numDescriptors, total, i, s;
+    unsigned int checksum;
+
+    if (sector >= EndOfJournal)
+        return 0;
+    kernel->synchDisk->ReadSector(sector, first);
+    if (hdr->magic != JournalMagic || hdr->seq != seq ||
+        hdr->numLogged < 0 || hdr->numLogged > MaxTransactionSectors ||
+        hdr->numRevoked < 0 || hdr->numRevoked > MaxRevoked)
+        return 0;
+    numDescriptors = DescriptorSectors(hdr->numLogged, hdr->numRevoked);
+    total = numDescriptors + hdr->numLogged;
+    if (sector + total > EndOfJournal)
+        return 0;
+
+    buffer = new char[total * SectorSize];
+    kernel->synchDisk->ReadSectors(sector, total, buffer);
+    hdr = (RecordHeader *)buffer;
+    sectors = (int *)(buffer + sizeof(RecordHeader));
+    checksum = hdr->checksum;
+    hdr->checksum = 0;
+    if (Checksum(buffer, total * SectorSize) != checksum) {
+        delete[] buffer;
+        return 0;  // only partly written: never committed
+    }
+    for (i = 0; i < hdr->numLogged + hdr->numRevoked; i++) {
+        if (!OutsideLog(sectors[i])) {
+            delete[] buffer;
+            return 0;  // not a sector the log can have a copy of
+        }
+    }
+
+    for (i = 0; i < hdr->numRevoked; i++) {
+        s = sectors[hdr->numLogged + i];
+        delete[] copies[s];
+        copies[s] = NULL;
+    }
+    for (i = 0; i < hdr->numLogged; i++) {
+        s = sectors[i];
+        if (copies[s] == NULL) {
+            copies[s] = new char[SectorSize];
+        }
+        bcopy(&buffer[(numDescriptors + i) * SectorSize], copies[s], SectorSize);
+    }
+    delete[] buffer;
+    return total;
+}
+
+//----------------------------------------------------------------------
+// Journal::Replay
+// 	When Nachos starts up on a disk that is already formatted, redo
+//	the transactions in the log: read their records in order, and
+//	write the latest copy of each sector in them where it belongs.
+//	Some or all of them may already be there; writing them again
+//	does no harm.  Then the log is emptied.
+//
+//	This is done before anything else reads the disk, so nothing is
+//	in the buffer cache yet, and the sectors go straight to disk.
+//----------------------------------------------------------------------
+
+void Journal::Replay() {
+    char buffer[SectorSize];
+    JournalStart *start = (JournalStart *)buffer;
+    char **copies = new char *[NumSectors];
+    int sector = FirstRecordSector;
+    int firstSeq, numSectors, i;
+
+    for (i = 0; i < NumSectors; i++) {
+        copies[i] = NULL;
+    }
+    kernel->synchDisk->ReadSector(JournalSector, buffer);
+    if (start->magic != JournalMagic) {
+        DEBUG(dbgFile, "No journal on the disk; starting one");
+        nextSeq = 1;
+    } else {
+        nextSeq = start->firstSeq;
+        firstSeq = nextSeq;
+        while ((numSectors = ReadRecord(sector, nextSeq, copies)) > 0) {
+            sector += numSectors;
+            nextSeq++;
+        }
+        DEBUG(dbgFile, "Journal replay: " << nextSeq - firstSeq << " transactions");
+    }
+
+    numSectors = 0;
+    for (i = 0; i < NumSectors; i++) {
+        if (copies[i] != NULL) {
+            kernel->synchDisk->WriteSector(i, copies[i]);
+            delete[] copies[i];
+            numSectors++;
+        }
+    }
+    delete[] copies;
+    DEBUG(dbgFile, "Journal replay: " << numSectors << " sectors written");
+
+    head = FirstRecordSector;
+    WriteStart();  // what was in the log is on disk now
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Empty the log: have the buffer cache write back everything it
+//	has, so that every sector with a copy in the log is on disk, and
+//	then start the log over.  Also done when Nachos halts.
+//
+//	If a transaction is going on, the sectors it keeps in the cache
+//	cannot be written back yet, so only the rest are, and the log is
+//	left as it is.
+//----------------------------------------------------------------------
+
+void Journal::Checkpoint() {
+    DEBUG(dbgFile, "Journal checkpoint at transaction " << nextSeq);
+    kernel->bufferCache->Sync();
+    if (open) {
+        return;
+    }
+    for (int i = 0; i < NumSectors; i++) {
+        inLog[i] = FALSE;
+    }
+    head = FirstRecordSector;
+    WriteStart();
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Start a transaction, once any other thread's has committed.  If
+//	the log does not have room left for the biggest record there can
+//	be, empty it first.
+//----------------------------------------------------------------------
+
+void Journal::Begin() {
+    lock->Acquire();
+    ASSERT(!open);
+    if (head + MaxDescriptorSectors + MaxTransactionSectors > EndOfJournal) {
+        Checkpoint();
+    }
+    open = TRUE;
+    owner = kernel->currentThread;
+    tooBig = FALSE;
+    numLogged = 0;
+    numRevoked = 0;
+}
+
+//----------------------------------------------------------------------
+// Journal::Written
+// 	Called by the buffer cache, with its lock held, when a sector has
+//	been written.  If the thread doing a transaction wrote it, it
+//	becomes part of the transaction, and the cache must not write it
+//	back until it commits.  Other threads' writes (file data) are not
+//	journaled.
+//
+//	A transaction that writes more than MaxTransactionSectors is too
+//	big to go in the log; its sectors are written back like any
+//	others, and when it ends, the log is emptied.  It is then not
+//	safe against Nachos being killed before it ends.
+//
+//	"sector" -- the sector written
+//----------------------------------------------------------------------
+
+bool Journal::Written(int sector) {
+    if (!open || tooBig || kernel->currentThread != owner)
+        return FALSE;
+    if (inTransaction[sector])
+        return TRUE;  // written before in this transaction
+    if (numLogged == MaxTransactionSectors) {
+        DEBUG(dbgFile, "Transaction " << nextSeq << " is too big to journal");
+        tooBig = TRUE;
+        return FALSE;
+    }
+    inTransaction[sector] = TRUE;
+    logged[numLogged++] = sector;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Freed
+// 	Called by the buffer cache, with its lock held, when a sector
+//	stops being part of any file.  It is dropped from the transaction,
+//	and if the log has a copy of it, revoked.
+//
+//	"sector" -- the sector freed
+//----------------------------------------------------------------------
+
+void Journal::Freed(int sector) {
+    int i;
+
+    ASSERT(open && kernel->currentThread == owner);
+    if (inTransaction[sector]) {
+        for (i = 0; logged[i] != sector; i++)
+            ;
+        logged[i] = logged[--numLogged];
+        inTransaction[sector] = FALSE;
+    }
+    if (inLog[sector]) {
+        for (i = 0; i < numRevoked && revoked[i] != sector; i++)
+            ;
+        if (i < numRevoked) {
+            return;  // already revoked
+        }
+        if (numRevoked == MaxRevoked) {
+            tooBig = TRUE;
+        } else {
+            revoked[numRevoked++] = sector;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	Commit a transaction: write its record to the log, with one disk
+//	request.  Once it is there, the sectors written can go to disk
+//	whenever the buffer cache gets around to it.  Then the next
+//	thread waiting to begin one can go ahead.
+//----------------------------------------------------------------------
+
+void Journal::End() {
+    int i;
+
+    ASSERT(open && kernel->currentThread == owner);
+    open = FALSE;
+    owner = NULL;
+    if (tooBig) {
+        for (i = 0; i < numLogged; i++) {
+            inTransaction[logged[i]] = FALSE;
+            kernel->bufferCache->Unpin(logged[i]);
+        }
+        Checkpoint();  // the log may have older copies of them
+    } else if (numLogged > 0 || numRevoked > 0) {
+        Commit();
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Write the record of the transaction that has just ended to the
+//	log, and let the buffer cache write back the sectors in it.
+//----------------------------------------------------------------------
+
+void Journal::Commit() {
+    int numDescriptors, total, i;
+    char *buffer;
+    RecordHeader *hdr;
+    int *sectors;
+
+    numDescriptors = DescriptorSectors(numLogged, numRevoked);
+    total = numDescriptors + numLogged;
+    ASSERT(head + total <= EndOfJournal);
+    buffer = new char[total * SectorSize];
+    bzero(buffer, total * SectorSize);
+    hdr = (RecordHeader *)buffer;
+    sectors = (int *)(buffer + sizeof(RecordHeader));
+    hdr->magic = JournalMagic;
+    hdr->seq = nextSeq;
+    hdr->numLogged = numLogged;
+    hdr->numRevoked = numRevoked;
+    for (i = 0; i < numLogged; i++) {
+        sectors[i] = logged[i];
+        kernel->bufferCache->ReadSector(logged[i],
+                                        &buffer[(numDescriptors + i) * SectorSize]);
+    }
+    for (i = 0; i < numRevoked; i++) {
+        sectors[numLogged + i] = revoked[i];
+    }
+    hdr->checksum = Checksum(buffer, total * SectorSize);
+
+    DEBUG(dbgFile, "Committing transaction " << nextSeq << ", " << numLogged
+          << " sectors, at " << head);
+    kernel->synchDisk->WriteSectors(head, total, buffer);
+    kernel->stats->numJournalCommits++;
+    head += total;
+    nextSeq++;
+
+    for (i = 0; i < numLogged; i++) {
+        inLog[logged[i]] = TRUE;
+        inTransaction[logged[i]] = FALSE;
+        kernel->bufferCache->Unpin(logged[i]);
+    }
+    delete[] buffer;
+}
@@ -0,0 +1,91 @@
+// journal.h
+//	Data structures for a write-ahead journal of file system metadata.
+//
+//	An operation that changes the file system (Create, Remove) is
+//	made a transaction: every sector it writes -- file headers,
+//	directories, the bitmap of free sectors -- is kept in the buffer
+//	cache, and not written to disk, until the transaction commits.
+//	To commit, copies of all of them go to the log, a fixed area of
+//	the disk, with one sequential write.  Once that is done, the
+//	cache is free to write the sectors to where they belong whenever
+//	it likes.
+//
+//	If Nachos is killed, the next time it starts the transactions in
+//	the log are done over, so each one is either all on disk or not
+//	at all.
+//
+//	The log is emptied (a checkpoint) when it is nearly full: the
+//	cache writes everything back, and the log starts over.
+//
+//	File data is not journaled, only metadata.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "copyright.h"
+#include "disk.h"
+
+class Lock;
+class Thread;
+
+const int JournalSector = 2;        // the log's first sector, which says
+                                    // where in the log to start
+const int NumJournalSectors = 128;  // sectors taken by the log
+const int MaxTransactionSectors = 32;  // most sectors a transaction can
+                                       // write and still be journaled
+const int MaxDescriptorSectors = 8;    // most sectors saying what is
+                                       // in a transaction's record
+
+// The following class defines the journal.  The buffer cache tells it
+// about every sector written or freed while a transaction is going on.
+// One transaction goes on at a time; a thread that begins another
+// waits until it has committed.
+
+class Journal {
+   public:
+    Journal();   // Initialize the journal in memory
+    ~Journal();  // De-allocate it
+
+    void Format();  // Start an empty log on a new disk
+    void Replay();  // Redo the transactions in the log, and
+                    // empty it; when Nachos starts up
+
+    void Begin();  // Start a transaction
+    void End();    // Commit it
+
+    void Checkpoint();  // Write back what is in the log, and
+                        // empty it
+
+    bool Written(int sector);  // A sector has been written: return
+                               // TRUE if the cache must keep it
+                               // until the transaction commits
+    void Freed(int sector);    // A sector is no longer in any file
+
+   private:
+    int head;      // where the next record goes in the log
+    int nextSeq;   // the number of the next transaction
+    bool open;     // is a transaction going on?
+    bool tooBig;   // has it written too much to be journaled?
+    Lock *lock;    // held from Begin to End
+    Thread *owner; // the thread doing the transaction; what
+                   // other threads write is not part of it
+
+    int *logged;      // the sectors the transaction has written
+    int numLogged;
+    int *revoked;     // the sectors it has freed that the log has
+    int numRevoked;   // copies of, which must not be done over
+    bool *inTransaction;  // is each sector in "logged"?
+    bool *inLog;          // has the log a copy of each sector?
+
+    void Commit();          // Log the transaction that just ended
+    void WriteStart();      // Write the log's first sector
+    int ReadRecord(int sector, int seq, char **copies);
+    // Read a record from the log, and keep the
+    // copies of the sectors in it
+};
+
+#endif  // JOURNAL_H
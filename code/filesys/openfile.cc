@@ -5,7 +5,8 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  It comes from the kernel's table
+//	of file headers, so that the file's other opens share it.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -14,32 +15,34 @@
 
 #include "openfile.h"
 
+#include "buffercache.h"
 #include "copyright.h"
 #include "filehdr.h"
 #include "main.h"
-#include "synchdisk.h"
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open (if it is not there already).
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector) {
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    hdr = kernel->fileHeaders->Open(sector);
+    hdrSector = sector;
     seekPosition = 0;
+    nextPosition = 0;
+    readAheadWindow = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
-// 	Close a Nachos file, de-allocating any in-memory data structures.
+// 	Close a Nachos file, giving back the file header.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile() {
-    delete hdr;
+    kernel->fileHeaders->Close(hdrSector);
 }
 
 //----------------------------------------------------------------------
@@ -87,16 +90,17 @@ int OpenFile::Write(char *into, int numBytes) {
 //
 //	There is no guarantee the request starts or ends on an even disk sector
 //	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
+//	sector at a time.  So we go through the buffer cache, which copies
+//	just the part of each sector we want straight to or from the
+//	caller's buffer.  For a sector that is only partly written, the
+//	cache reads in the rest of it (unless it already has it); a sector
+//	that is written in full is never read.
 //
-//	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
-//	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	A read goes a run of sectors at a time, where the file's sectors
+//	are next to each other on disk, so that the cache can read in the
+//	ones it does not have with one disk request.  A write just goes a
+//	sector at a time: it only changes the cache, which writes dirty
+//	sectors that are next to each other back together.
 //
 //	"into" -- the buffer to contain the data to be read from disk
 //	"from" -- the buffer containing the data to be written to disk
@@ -107,8 +111,7 @@ int OpenFile::Write(char *into, int numBytes) {
 
 int OpenFile::ReadAt(char *into, int numBytes, int position) {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int done, sector, runLength, offset, n;
 
     if ((numBytes <= 0) || (position >= fileLength))
         return 0;  // check request
@@ -116,27 +119,19 @@ int OpenFile::ReadAt(char *into, int numBytes, int position) {
         numBytes = fileLength - position;
     DEBUG(dbgFile, "Reading " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize),
-                                      &buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete[] buf;
+    for (done = 0; done < numBytes; done += n) {
+        sector = hdr->ByteToRun(position + done, &runLength);
+        offset = (position + done) % SectorSize;
+        n = min(runLength * SectorSize - offset, numBytes - done);
+        kernel->bufferCache->ReadRun(sector, &into[done], offset, n);
+    }
+    ReadAhead(position, numBytes);
     return numBytes;
 }
 
 int OpenFile::WriteAt(char *from, int numBytes, int position) {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int done, offset, n;
 
     if ((numBytes <= 0) || (position >= fileLength))
         return 0;  // check request
@@ -144,31 +139,45 @@ int OpenFile::WriteAt(char *from, int numBytes, int position) {
         numBytes = fileLength - position;
     DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    buf = new char[numSectors * SectorSize];
-
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
-
-    // read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize],
-               SectorSize, lastSector * SectorSize);
+    for (done = 0; done < numBytes; done += n) {
+        offset = (position + done) % SectorSize;
+        n = min(SectorSize - offset, numBytes - done);
+        kernel->bufferCache->Write(hdr->ByteToSector(position + done),
+                                   &from[done], offset, n);
+    }
+    return numBytes;
+}
 
-    // copy in the bytes we want to change
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	After a read, if the file is being read sequentially (this read
+//	started where the last one ended), ask the buffer cache to start
+//	reading in the sectors after it, in case the next read wants them.
+//	How many is doubled, up to MaxReadAhead, each time the file is read
+//	sequentially, and halved each time it is not.
+//
+//	This is done once the read is over, so that the sectors read ahead
+//	do not get in the way of the ones the read itself wants.
+//
+//	"position", "numBytes" -- the part of the file that was read
+//----------------------------------------------------------------------
 
-    // write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize),
-                                       &buf[(i - firstSector) * SectorSize]);
-    delete[] buf;
-    return numBytes;
+void OpenFile::ReadAhead(int position, int numBytes) {
+    int lastSector = divRoundDown(position + numBytes - 1, SectorSize);
+    int fileSectors = divRoundUp(hdr->FileLength(), SectorSize);
+    int lastWanted, i;
+
+    if (position == nextPosition) {
+        readAheadWindow = (readAheadWindow == 0) ? 1 : min(2 * readAheadWindow, MaxReadAhead);
+    } else {
+        readAheadWindow /= 2;
+    }
+    nextPosition = position + numBytes;
+
+    lastWanted = min(lastSector + readAheadWindow, fileSectors - 1);
+    for (i = lastSector + 1; i <= lastWanted; i++) {
+        kernel->bufferCache->ReadAhead(hdr->ByteToSector(i * SectorSize));
+    }
 }
 
 //----------------------------------------------------------------------
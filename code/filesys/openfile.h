@@ -94,8 +94,18 @@ class OpenFile {
                    // end of file, tell, lseek back
 
    private:
-    FileHeader *hdr;   // Header for this file
+    FileHeader *hdr;   // Header for this file, shared with
+                       // other opens of it
+    int hdrSector;     // Where the header is on disk
     int seekPosition;  // Current position within the file
+    int nextPosition;  // Where a read continuing the last one
+                       // would start
+    int readAheadWindow;  // How many sectors past the end of a
+                          // read to read ahead
+
+    void ReadAhead(int position, int numBytes);
+    // If reading sequentially, get the
+    // sectors past a read coming
 };
 
 #endif  // FILESYS
@@ -9,6 +9,7 @@
 #include "pbitmap.h"
 
 #include "copyright.h"
+#include "disk.h"
 
 //----------------------------------------------------------------------
 // PersistentBitmap::PersistentBitmap(int)
@@ -21,6 +22,11 @@
 //----------------------------------------------------------------------
 
 PersistentBitmap::PersistentBitmap(int numItems) : Bitmap(numItems) {
+    numMapSectors = divRoundUp(numWords * sizeof(unsigned), SectorSize);
+    dirty = new bool[numMapSectors];
+    for (int i = 0; i < numMapSectors; i++) {
+        dirty[i] = TRUE;  // none of it is on disk yet
+    }
 }
 
 //----------------------------------------------------------------------
@@ -36,10 +42,13 @@ PersistentBitmap::PersistentBitmap(int numItems) : Bitmap(numItems) {
 //----------------------------------------------------------------------
 
 PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems) : Bitmap(numItems) {
+    numMapSectors = divRoundUp(numWords * sizeof(unsigned), SectorSize);
+    dirty = new bool[numMapSectors];
+
     // map has already been initialized by the BitMap constructor,
     // but we will just overwrite that with the contents of the
     // map found in the file
-    file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    FetchFrom(file);
 }
 
 //----------------------------------------------------------------------
@@ -48,6 +57,7 @@ PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems) : Bitmap(numIte
 //----------------------------------------------------------------------
 
 PersistentBitmap::~PersistentBitmap() {
+    delete[] dirty;
 }
 
 //----------------------------------------------------------------------
@@ -59,15 +69,48 @@ PersistentBitmap::~PersistentBitmap() {
 
 void PersistentBitmap::FetchFrom(OpenFile *file) {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    Summarize();
+    for (int i = 0; i < numMapSectors; i++) {
+        dirty[i] = FALSE;
+    }
 }
 
 //----------------------------------------------------------------------
 // PersistentBitmap::WriteBack
-// 	Store the contents of a persistent bitmap to a Nachos file.
+// 	Store the contents of a persistent bitmap to a Nachos file.  Only
+//	the sectors that have changed are written, each run of them next
+//	to each other in the file with one write.
 //
 //	"file" is the place to write the bitmap to
 //----------------------------------------------------------------------
 
 void PersistentBitmap::WriteBack(OpenFile *file) {
-    file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
+    int numBytes = numWords * sizeof(unsigned);
+    int first, last;
+
+    for (first = 0; first < numMapSectors; first = last) {
+        if (!dirty[first]) {
+            last = first + 1;
+            continue;
+        }
+        for (last = first; last < numMapSectors && dirty[last]; last++) {
+            dirty[last] = FALSE;
+        }
+        file->WriteAt((char *)map + first * SectorSize,
+                      min(last * SectorSize, numBytes) - first * SectorSize,
+                      first * SectorSize);
+    }
+}
+
+//----------------------------------------------------------------------
+// PersistentBitmap::Changed
+// 	A word of the bitmap has changed: bring the summary up to date,
+//	and note that the sector of the file it is in has to be written.
+//
+//	"word" is the number of the word.
+//----------------------------------------------------------------------
+
+void PersistentBitmap::Changed(int word) {
+    Bitmap::Changed(word);
+    dirty[word * sizeof(unsigned) / SectorSize] = TRUE;
 }
@@ -6,6 +6,9 @@
 //    when it is created, or it can be initialized later using
 //    the FetchFrom method
 //
+//    It keeps track of which sectors of its file have changed, so
+//    that WriteBack only writes those.
+//
 // Copyright (c) 1992,1993,1995 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
@@ -29,7 +32,16 @@ class PersistentBitmap : public Bitmap {
     ~PersistentBitmap();  // deallocate bitmap
 
     void FetchFrom(OpenFile *file);  // read bitmap from the disk
-    void WriteBack(OpenFile *file);  // write bitmap contents to disk
+    void WriteBack(OpenFile *file);  // write bitmap contents to disk,
+                                     // the sectors that have changed
+
+   protected:
+    void Changed(int word);  // Note the sector the word is in
+
+   private:
+    int numMapSectors;  // sectors the bitmap takes up in its file
+    bool *dirty;        // has each of them changed since it was
+                        // read or written?
 };
 
 #endif  // PBITMAP_H
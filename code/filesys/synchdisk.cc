@@ -5,10 +5,16 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Because the physical disk can only handle one operation at a
+//	time, requests wait in a queue until it is free.  Each request
+//	has its own semaphore, which the interrupt handler signals when
+//	that request is done; it then sends the disk the next request,
+//	chosen by the disk policy.  A read ahead is the same, except that
+//	nobody waits for it: the interrupt handler tells whoever asked
+//	for it instead.
+//
+//	The queue is shared with the interrupt handler, so it is only
+//	touched with interrupts off.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -17,18 +23,52 @@
 #include "synchdisk.h"
 
 #include "copyright.h"
+#include "main.h"
+#include "synch.h"
+
+//----------------------------------------------------------------------
+// DiskRequest::DiskRequest
+// 	Describe a request to read or write a run of sectors.
+//
+//	"sectorNumber" -- the first disk sector
+//	"numSectors" -- how many sectors
+//	"buffer" -- where the data comes from or goes
+//	"isWrite" -- is it a write?
+//	"toCall" -- what to call when it is done; NULL if a thread will
+//		wait for it
+//----------------------------------------------------------------------
+
+DiskRequest::DiskRequest(int sectorNumber, int numSectors, char *buffer,
+                         bool isWrite, CallBackObj *toCall) {
+    sector = sectorNumber;
+    count = numSectors;
+    data = buffer;
+    writing = isWrite;
+    whenDone = toCall;
+    done = (toCall == NULL) ? new Semaphore("disk request", 0) : NULL;
+    issued = kernel->stats->totalTicks;
+}
+
+DiskRequest::~DiskRequest() {
+    delete done;
+}
 
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
 //	initializing the physical disk.
 //
+//	"name" -- which simulated disk to use (see Disk::Disk)
+//	"order" -- how to choose among waiting requests
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk() {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
-    disk = new Disk(this);
+SynchDisk::SynchDisk(char *name, DiskPolicy order) {
+    policy = order;
+    waiting = new List<DiskRequest *>;
+    current = NULL;
+    headSector = 0;
+    movingUp = TRUE;
+    disk = new Disk(name, this);
 }
 
 //----------------------------------------------------------------------
@@ -39,8 +79,7 @@ SynchDisk::SynchDisk() {
 
 SynchDisk::~SynchDisk() {
     delete disk;
-    delete lock;
-    delete semaphore;
+    delete waiting;
 }
 
 //----------------------------------------------------------------------
@@ -53,10 +92,7 @@ SynchDisk::~SynchDisk() {
 //----------------------------------------------------------------------
 
 void SynchDisk::ReadSector(int sectorNumber, char* data) {
-    lock->Acquire();  // only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();  // wait for interrupt
-    lock->Release();
+    ReadSectors(sectorNumber, 1, data);
 }
 
 //----------------------------------------------------------------------
@@ -69,18 +105,216 @@ void SynchDisk::ReadSector(int sectorNumber, char* data) {
 //----------------------------------------------------------------------
 
 void SynchDisk::WriteSector(int sectorNumber, char* data) {
-    lock->Acquire();  // only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();  // wait for interrupt
-    lock->Release();
+    WriteSectors(sectorNumber, 1, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read a run of consecutive disk sectors into a buffer, with a
+//	single request to the disk.  Return only after the data has been
+//	read.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"numSectors" -- how many sectors to read
+//	"data" -- the buffer to hold their contents
+//----------------------------------------------------------------------
+
+void SynchDisk::ReadSectors(int sectorNumber, int numSectors, char *data) {
+    DiskRequest request(sectorNumber, numSectors, data, FALSE, NULL);
+
+    Queue(&request);
+    request.done->P();  // wait for interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectors
+// 	Write a buffer into a run of consecutive disk sectors, with a
+//	single request to the disk.  Return only after the data has been
+//	written.
+//
+//	"sectorNumber" -- the first disk sector to be written
+//	"numSectors" -- how many sectors to write
+//	"data" -- their new contents
+//----------------------------------------------------------------------
+
+void SynchDisk::WriteSectors(int sectorNumber, int numSectors, char *data) {
+    DiskRequest request(sectorNumber, numSectors, data, TRUE, NULL);
+
+    Queue(&request);
+    request.done->P();  // wait for interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAhead
+// 	Ask for a disk sector to be read, and return without waiting.
+//	When the data is in, the disk interrupt handler calls "whenDone";
+//	until then "data" must stay put.
+//
+//	"sectorNumber" -- the disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sector
+//	"whenDone" -- what to call when it has been read
+//----------------------------------------------------------------------
+
+void SynchDisk::ReadAhead(int sectorNumber, char *data, CallBackObj *whenDone) {
+    ASSERT(whenDone != NULL);
+    Queue(new DiskRequest(sectorNumber, 1, data, FALSE, whenDone));
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Queue
+// 	Put a request in the queue for the disk, and start it right away
+//	if the disk has nothing to do.
+//----------------------------------------------------------------------
+
+void SynchDisk::Queue(DiskRequest *request) {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(request->sector >= 0 && request->count > 0 &&
+           request->sector + request->count <= NumSectors);
+    waiting->Append(request);
+    if (current == NULL) {
+        StartNext();
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	Send the disk the request the policy picks, if any are waiting.
+//	Called with interrupts off, when the disk is free.
+//----------------------------------------------------------------------
+
+void SynchDisk::StartNext() {
+    ASSERT(current == NULL);
+    if (waiting->IsEmpty()) {
+        return;
+    }
+    current = ChooseNext();
+    waiting->Remove(current);
+    headSector = current->sector + current->count - 1;
+    if (current->writing) {
+        disk->WriteSectors(current->sector, current->count, current->data);
+    } else {
+        disk->ReadSectors(current->sector, current->count, current->data);
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ChooseNext
+// 	Return the waiting request to send to the disk next.  There must
+//	be at least one.  Among equally good ones, the one that has waited
+//	longest goes first.
+//
+//	FCFS -- the one that has waited longest
+//	SSTF -- the one with the least seek and rotational delay, as
+//		worked out by the disk itself
+//	SCAN -- the nearest one in the direction the head last moved;
+//		if there are none that way, the head turns around
+//	CLOOK -- the nearest one at or above the head; if there are
+//		none, the lowest one
+//----------------------------------------------------------------------
+
+DiskRequest *SynchDisk::ChooseNext() {
+    ListIterator<DiskRequest *> iter(waiting);
+    DiskRequest *best = NULL;
+    DiskRequest *lowest = NULL;  // for CLOOK, to wrap around to
+    int bestLatency = 0;
+
+    if (policy == DiskFCFS) {
+        return waiting->Front();
+    }
+    for (; !iter.IsDone(); iter.Next()) {
+        DiskRequest *r = iter.Item();
+
+        switch (policy) {
+            case DiskSSTF: {
+                int latency = disk->ComputeLatency(r->sector, r->writing);
+                if (best == NULL || latency < bestLatency) {
+                    best = r;
+                    bestLatency = latency;
+                }
+                break;
+            }
+            case DiskSCAN:
+                if (movingUp && r->sector >= headSector &&
+                    (best == NULL || r->sector < best->sector)) {
+                    best = r;
+                } else if (!movingUp && r->sector <= headSector &&
+                           (best == NULL || r->sector > best->sector)) {
+                    best = r;
+                }
+                break;
+            case DiskCLOOK:
+                if (r->sector >= headSector &&
+                    (best == NULL || r->sector < best->sector)) {
+                    best = r;
+                }
+                if (lowest == NULL || r->sector < lowest->sector) {
+                    lowest = r;
+                }
+                break;
+            default:
+                ASSERTNOTREACHED();
+        }
+    }
+    if (best == NULL && policy == DiskSCAN) {
+        movingUp = !movingUp;  // nothing more this way
+        return ChooseNext();
+    }
+    if (best == NULL) {
+        best = lowest;  // CLOOK: back to the start
+    }
+    return best;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::CallBack
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  The current request is done: wake up the
+//	thread waiting for it (or, for a read ahead, tell whoever asked
+//	for it), and send the disk the next one.
 //----------------------------------------------------------------------
 
 void SynchDisk::CallBack() {
-    semaphore->V();
+    DiskRequest *request = current;
+    int latency, bucket = 0;
+
+    ASSERT(request != NULL);
+    latency = kernel->stats->totalTicks - request->issued;
+    while (latency >= (RotationTime << bucket) && bucket < NumLatencyBuckets - 1) {
+        bucket++;
+    }
+    kernel->stats->diskLatency[bucket]++;
+
+    current = NULL;
+    StartNext();
+    if (request->whenDone != NULL) {
+        request->whenDone->CallBack();
+        delete request;
+    } else {
+        request->done->V();  // the request belongs to the waiting thread
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ParsePolicy
+// 	Convert the name of a disk scheduling policy, as given on the
+//	command line.  Return FALSE if it is not one we know.
+//
+//	"name" -- "fcfs", "sstf", "scan" or "clook"
+//	"order" -- where to store the policy
+//----------------------------------------------------------------------
+
+bool SynchDisk::ParsePolicy(char *name, DiskPolicy *order) {
+    if (strcmp(name, "fcfs") == 0) {
+        *order = DiskFCFS;
+    } else if (strcmp(name, "sstf") == 0) {
+        *order = DiskSSTF;
+    } else if (strcmp(name, "scan") == 0) {
+        *order = DiskSCAN;
+    } else if (strcmp(name, "clook") == 0) {
+        *order = DiskCLOOK;
+    } else {
+        return FALSE;
+    }
+    return TRUE;
 }
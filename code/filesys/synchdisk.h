@@ -13,7 +13,38 @@
 
 #include "callback.h"
 #include "disk.h"
-#include "synch.h"
+#include "list.h"
+
+class Semaphore;
+
+// How to choose the next request for the disk, among those waiting
+enum DiskPolicy {
+    DiskFCFS,   // the one that has waited longest
+    DiskSSTF,   // the one the head can get to soonest
+    DiskSCAN,   // the nearest one in the direction the head is
+                // going; turn around when there are no more
+    DiskCLOOK   // the nearest one at a higher sector; go back to
+                // the lowest when there are no more
+};
+
+// A request to read or write a run of sectors, waiting for the disk
+// or being done by it.
+
+class DiskRequest {
+   public:
+    DiskRequest(int sectorNumber, int numSectors, char *buffer,
+                bool isWrite, CallBackObj *toCall);
+    ~DiskRequest();
+
+    int sector;           // the first sector
+    int count;            // how many sectors
+    char *data;           // where the bytes come from or go
+    bool writing;         // is it a write?
+    CallBackObj *whenDone;  // called when it is done, or NULL
+                            // if a thread waits on "done"
+    Semaphore *done;      // V'ed when it is done, if whenDone is NULL
+    int issued;           // totalTicks when it was asked for
+};
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
@@ -25,11 +56,16 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// Requests from different threads wait in a queue, and the disk takes
+// them in the order given by the disk policy, rather than the order
+// they came in.
 
 class SynchDisk : public CallBackObj {
    public:
-    SynchDisk();   // Initialize a synchronous disk,
-                   // by initializing the raw Disk.
+    SynchDisk(char *name, DiskPolicy order);
+    // Initialize a synchronous disk,
+    // by initializing the raw Disk.
     ~SynchDisk();  // De-allocate the synch disk data
 
     void ReadSector(int sectorNumber, char *data);
@@ -40,16 +76,36 @@ class SynchDisk : public CallBackObj {
     // then wait until the request is done.
     void WriteSector(int sectorNumber, char *data);
 
+    void ReadSectors(int sectorNumber, int numSectors, char *data);
+    void WriteSectors(int sectorNumber, int numSectors, char *data);
+    // Read/write "numSectors" consecutive
+    // sectors with one disk request
+
+    void ReadAhead(int sectorNumber, char *data, CallBackObj *whenDone);
+    // Ask for a sector to be read and return
+    // at once; "whenDone" is called from the
+    // interrupt handler when it is in.
+
     void CallBack();  // Called by the disk device interrupt
                       // handler, to signal that the
                       // current disk operation is complete.
 
+    static bool ParsePolicy(char *name, DiskPolicy *order);
+    // Convert "fcfs", "sstf", "scan" or "clook"
+
    private:
     Disk *disk;            // Raw disk device
-    Semaphore *semaphore;  // To synchronize requesting thread
-                           // with the interrupt handler
-    Lock *lock;            // Only one read/write request
-                           // can be sent to the disk at a time
+    DiskPolicy policy;     // Which waiting request goes next
+    List<DiskRequest *> *waiting;  // Requests not yet sent to the disk
+    DiskRequest *current;  // The one the disk is doing, or NULL
+    int headSector;        // Where the last request sent ends
+    bool movingUp;         // For SCAN: is the head sweeping
+                           // towards higher sectors?
+
+    void Queue(DiskRequest *request);  // Add a request, and start it
+                                       // if the disk is free
+    void StartNext();           // Send the next request to the disk
+    DiskRequest *ChooseNext();  // Which one, according to the policy
 };
 
 #endif  // SYNCHDISK_H
@@ -2,6 +2,12 @@
 //	Routines to manage a bitmap -- an array of bits each of which
 //	can be either on or off.  Represented as an array of integers.
 //
+//	Searches go a word at a time where they can: a word with all its
+//	bits set or all clear is taken in one step, and so is each run of
+//	like bits within a word, found by counting trailing zeros.  Runs
+//	of full words are skipped using the summary of which words are
+//	full.
+//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
@@ -26,10 +32,15 @@ Bitmap::Bitmap(int numItems) {
 
     numBits = numItems;
     numWords = divRoundUp(numBits, BitsInWord);
+    numFullWords = divRoundUp(numWords, BitsInWord);
     map = new unsigned int[numWords];
+    full = new unsigned int[numFullWords];
     for (i = 0; i < numWords; i++) {
         map[i] = 0;  // initialize map to keep Purify happy
     }
+    for (i = 0; i < numFullWords; i++) {
+        full[i] = 0;
+    }
     for (i = 0; i < numBits; i++) {
         Clear(i);
     }
@@ -41,7 +52,8 @@ Bitmap::Bitmap(int numItems) {
 //----------------------------------------------------------------------
 
 Bitmap::~Bitmap() {
-    delete map;
+    delete[] map;
+    delete[] full;
 }
 
 //----------------------------------------------------------------------
@@ -55,6 +67,7 @@ void Bitmap::Mark(int which) {
     ASSERT(which >= 0 && which < numBits);
 
     map[which / BitsInWord] |= 1 << (which % BitsInWord);
+    Changed(which / BitsInWord);
 
     ASSERT(Test(which));
 }
@@ -70,6 +83,7 @@ void Bitmap::Clear(int which) {
     ASSERT(which >= 0 && which < numBits);
 
     map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    Changed(which / BitsInWord);
 
     ASSERT(!Test(which));
 }
@@ -91,6 +105,91 @@ bool Bitmap::Test(int which) const {
     }
 }
 
+//----------------------------------------------------------------------
+// Bitmap::Changed
+// 	A word of the bitmap has changed: record in the summary whether
+//	it is full.  Subclasses that need to know what has changed
+//	override this, and call it.
+//
+//	"word" is the number of the word.
+//----------------------------------------------------------------------
+
+void Bitmap::Changed(int word) {
+    unsigned int bit = 1u << (word % BitsInWord);
+
+    if (map[word] == ~0u) {
+        full[word / BitsInWord] |= bit;
+    } else {
+        full[word / BitsInWord] &= ~bit;
+    }
+}
+
+//----------------------------------------------------------------------
+// Bitmap::Summarize
+// 	Work out the whole summary again, once the words of the bitmap
+//	have been filled in some other way than by Mark and Clear.
+//----------------------------------------------------------------------
+
+void Bitmap::Summarize() {
+    int i;
+
+    for (i = 0; i < numFullWords; i++) {
+        full[i] = 0;
+    }
+    for (i = 0; i < numWords; i++) {
+        if (map[i] == ~0u) {
+            full[i / BitsInWord] |= 1u << (i % BitsInWord);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Bitmap::NextNotFull
+// 	Return the number of the first word, from "word" on, that has a
+//	clear bit, or numWords if there is none.  Looks at the summary,
+//	so 32 full words go by at a time.
+//
+//	"word" is where to start looking.
+//----------------------------------------------------------------------
+
+int Bitmap::NextNotFull(int word) const {
+    int i = word / BitsInWord;
+    unsigned int notFull;
+
+    if (i >= numFullWords) {
+        return numWords;
+    }
+    notFull = ~full[i] & (~0u << (word % BitsInWord));
+    while (notFull == 0) {
+        if (++i == numFullWords) {
+            return numWords;
+        }
+        notFull = ~full[i];
+    }
+    return min(i * BitsInWord + __builtin_ctz(notFull), numWords);
+}
+
+//----------------------------------------------------------------------
+// Bitmap::RunInWord
+// 	Return how many bits, from bit "which" to the end of its word,
+//	are the same as bit "which", and whether they are set.  Those
+//	past the end of the bitmap in the last word count as clear.
+//
+//	"which" is the number of the first bit.
+//	"isSet" is where to store whether it is set.
+//----------------------------------------------------------------------
+
+int Bitmap::RunInWord(int which, bool *isSet) const {
+    unsigned int word = map[which / BitsInWord] >> (which % BitsInWord);
+    int left = BitsInWord - which % BitsInWord;  // bits to the end of the word
+
+    *isSet = (word & 1) != 0;
+    if (*isSet) {
+        word = ~word;  // the bits shifted in are now set, and end the run
+    }
+    return (word == 0) ? left : min((int)__builtin_ctz(word), left);
+}
+
 //----------------------------------------------------------------------
 // Bitmap::FindAndSet
 // 	Return the number of the first bit which is clear.
@@ -101,32 +200,166 @@ bool Bitmap::Test(int which) const {
 //----------------------------------------------------------------------
 
 int Bitmap::FindAndSet() {
-    for (int i = 0; i < numBits; i++) {
-        if (!Test(i)) {
-            Mark(i);
-            return i;
-        }
+    int which = FindFirstClear();
+
+    if (which >= 0) {
+        Mark(which);
     }
-    return -1;
+    return which;
 }
 
 //----------------------------------------------------------------------
 // Bitmap::NumClear
 // 	Return the number of clear bits in the bitmap.
 //	(In other words, how many bits are unallocated?)
+//	The bits past "numBits" in the last word are always clear, so
+//	counting the set bits a word at a time is enough.
 //----------------------------------------------------------------------
 
 int Bitmap::NumClear() const {
-    int count = 0;
+    int count = numBits;
 
-    for (int i = 0; i < numBits; i++) {
-        if (!Test(i)) {
-            count++;
-        }
+    for (int i = 0; i < numWords; i++) {
+        count -= __builtin_popcount(map[i]);
     }
     return count;
 }
 
+//----------------------------------------------------------------------
+// Bitmap::FindFirstSet
+// 	Return the number of the lowest bit which is set, or -1 if no
+//	bits are set.  Looks at a word of the bitmap at a time, so
+//	finding a bit is cheap even when most of the bitmap is clear.
+//----------------------------------------------------------------------
+
+int Bitmap::FindFirstSet() const {
+    for (int i = 0; i < numWords; i++) {
+        if (map[i] != 0) {
+            return i * BitsInWord + __builtin_ctz(map[i]);
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindFirstClear
+// 	Return the number of the lowest bit which is clear, or -1 if no
+//	bits are clear.  The summary gives the first word that is not
+//	full, without looking at the ones before it.
+//
+//	The bits past "numBits" in the last word are always clear, so
+//	they have to be ruled out.
+//----------------------------------------------------------------------
+
+int Bitmap::FindFirstClear() const {
+    int i = NextNotFull(0);
+    int which;
+
+    if (i == numWords) {
+        return -1;
+    }
+    which = i * BitsInWord + __builtin_ctz(~map[i]);
+    return (which < numBits) ? which : -1;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::ScanClearRun
+// 	Look for the lowest run of "wanted" clear bits, keeping track of
+//	the longest run seen on the way in case there is none.  Return
+//	"wanted" if there is such a run, and where it starts; otherwise
+//	return the length of the longest run, and where the lowest such
+//	run starts.
+//
+//	Full words are skipped using the summary; within other words,
+//	each run of like bits is stepped over at once.
+//
+//	"wanted" is how many clear bits in a row are wanted.
+//	"start" is where to store the number of the run's first bit, or
+//	-1 if no bits are clear.
+//----------------------------------------------------------------------
+
+int Bitmap::ScanClearRun(int wanted, int *start) const {
+    int longest = 0;
+    int run = 0;  // clear bits just before bit i
+    int i = 0;
+    int n;
+    bool isSet;
+
+    *start = -1;
+    while (i < numBits) {
+        if (i % BitsInWord == 0 && map[i / BitsInWord] == ~0u) {
+            i = NextNotFull(i / BitsInWord) * BitsInWord;
+            run = 0;
+        } else {
+            n = min(RunInWord(i, &isSet), numBits - i);
+            if (isSet) {
+                run = 0;
+            } else if (run + n >= wanted) {
+                *start = i - run;
+                return wanted;
+            } else {
+                run += n;
+                if (run > longest) {
+                    longest = run;
+                    *start = i + n - run;
+                }
+            }
+            i += n;
+        }
+    }
+    return longest;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindClearRun
+// 	Return the number of the first bit of the lowest run of "count"
+//	clear bits, or -1 if there is none.
+//
+//	"count" is how many clear bits in a row are needed.
+//----------------------------------------------------------------------
+
+int Bitmap::FindClearRun(int count) const {
+    int start;
+
+    ASSERT(count > 0);
+    return (ScanClearRun(count, &start) == count) ? start : -1;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::LongestClearRun
+// 	Return the length of the longest run of clear bits, and where the
+//	lowest such run starts.
+//
+//	"start" is where to store the number of the run's first bit, or
+//	-1 if no bits are clear.
+//----------------------------------------------------------------------
+
+int Bitmap::LongestClearRun(int *start) const {
+    return ScanClearRun(numBits + 1, start);  // longer than any run
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindAndSetRun
+// 	Find a run of clear bits, set them, and return the number of the
+//	first.  The lowest run of "wanted" bits is taken if there is one;
+//	if not, the longest run there is.  Return -1 if no bits are clear.
+//	Both are looked for in a single pass over the bitmap.
+//
+//	"wanted" is how many clear bits in a row are wanted.
+//	"count" is where to store how many were set.
+//----------------------------------------------------------------------
+
+int Bitmap::FindAndSetRun(int wanted, int *count) {
+    int start;
+
+    ASSERT(wanted > 0);
+    *count = ScanClearRun(wanted, &start);
+    for (int i = 0; i < *count; i++) {
+        Mark(start + i);
+    }
+    return start;
+}
+
 //----------------------------------------------------------------------
 // Bitmap::Print
 // 	Print the contents of the bitmap, for debugging.
@@ -156,19 +389,46 @@ void Bitmap::SelfTest() {
     ASSERT(numBits >= BitsInWord);  // bitmap must be big enough
 
     ASSERT(NumClear() == numBits);  // bitmap must be empty
+    ASSERT(FindFirstSet() == -1);
+    ASSERT(FindFirstClear() == 0);
+    ASSERT(FindClearRun(numBits) == 0);
     ASSERT(FindAndSet() == 0);
     Mark(31);
     ASSERT(Test(0) && Test(31));
+    ASSERT(FindFirstSet() == 0);
 
     ASSERT(FindAndSet() == 1);
+    ASSERT(FindFirstClear() == 2);
+    ASSERT(FindClearRun(29) == 2);
+    ASSERT(FindClearRun(30) == ((numBits >= 62) ? 32 : -1));
+    ASSERT(LongestClearRun(&i) == ((numBits >= 61) ? numBits - 32 : 29));
+    ASSERT(FindAndSetRun(3, &i) == 2 && i == 3);
+    Clear(2);
+    Clear(3);
+    Clear(4);
     Clear(0);
     Clear(1);
+    ASSERT(FindFirstSet() == 31);
     Clear(31);
+    Mark(numBits - 1);
+    ASSERT(FindFirstSet() == numBits - 1);
+    Clear(numBits - 1);
 
     for (i = 0; i < numBits; i++) {
         Mark(i);
     }
     ASSERT(FindAndSet() == -1);  // bitmap should be full!
+    ASSERT(FindFirstClear() == -1);
+    ASSERT(FindClearRun(1) == -1);
+    ASSERT(NumClear() == 0);
+    Clear(numBits - 1);
+    ASSERT(NumClear() == 1);
+    ASSERT(FindFirstClear() == numBits - 1);
+    ASSERT(FindClearRun(1) == numBits - 1);
+    ASSERT(FindClearRun(2) == -1);
+    ASSERT(FindAndSetRun(2, &i) == numBits - 1 && i == 1);
+    ASSERT(LongestClearRun(&i) == 0 && i == -1);
+    ASSERT(FindAndSetRun(2, &i) == -1 && i == 0);
     for (i = 0; i < numBits; i++) {
         Clear(i);
     }
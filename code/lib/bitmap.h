@@ -5,6 +5,11 @@
 //	Represented as an array of unsigned integers, on which we do
 //	modulo arithmetic to find the bit we are interested in.
 //
+//	Above the bits is a summary, with a bit for each word of the
+//	bitmap, set when every bit in the word is.  Searches for clear
+//	bits step over 32 full words at a time with it, so they stay
+//	quick on a big bitmap that is nearly full.
+//
 //	The bitmap can be parameterized with with the number of bits being
 //	managed.
 //
@@ -34,7 +39,7 @@ class Bitmap {
    public:
     Bitmap(int numItems);  // Initialize a bitmap, with "numItems" bits
                            // initially, all bits are cleared.
-    ~Bitmap();  // De-allocate bitmap
+    virtual ~Bitmap();  // De-allocate bitmap
 
     void Mark(int which);        // Set the "nth" bit
     void Clear(int which);       // Clear the "nth" bit
@@ -43,6 +48,21 @@ class Bitmap {
                        // effect, set the bit.
                        // If no bits are clear, return -1.
     int NumClear() const;  // Return the number of clear bits
+    int FindFirstSet() const;  // Return the # of the lowest set bit,
+                               // or -1 if no bits are set
+    int FindFirstClear() const;  // Return the # of the lowest clear bit,
+                                 // or -1 if no bits are clear
+    int FindClearRun(int count) const;
+    // Return the # of the first of "count"
+    // clear bits in a row, or -1 if there
+    // is no such run
+    int LongestClearRun(int *start) const;
+    // Return the length of the longest run
+    // of clear bits, and where it starts
+    int FindAndSetRun(int wanted, int *count);
+    // Find and set a run of "wanted" clear
+    // bits, or the longest there is if no
+    // run is that long; return its first #
 
     void Print() const;  // Print contents of bitmap
     void SelfTest();     // Test whether bitmap is working
@@ -54,6 +74,25 @@ class Bitmap {
                    //  multiple of the number of bits in
                    //  a word)
     unsigned int *map;  // bit storage
+    unsigned int *full;  // a bit for each word of "map", set
+                         // if all its bits are set
+    int numFullWords;    // number of words of "full"
+
+    virtual void Changed(int word);  // A word of "map" has changed;
+                                     // bring "full" up to date
+    void Summarize();  // Work out all of "full" again, after
+                       // "map" has been filled in
+
+   private:
+    int NextNotFull(int word) const;  // The first word of "map", from
+                                      // "word" on, with a clear bit
+    int RunInWord(int which, bool *isSet) const;
+    // How many bits from "which" on are
+    // the same as it, up to the end of its
+    // word; and whether they are set
+    int ScanClearRun(int wanted, int *start) const;
+    // Find the lowest run of "wanted" clear
+    // bits, or else the longest run
 };
 
 #endif  // BITMAP_H
@@ -0,0 +1,310 @@
+// heap.cc
+//     	Routines to manage a binary min-heap of "things".
+//	Heaps are implemented as templates so that we can store
+//	anything in a heap in a type-safe manner.
+//
+//	The heap is an array; the children of the item at index i are
+//	at indices 2i+1 and 2i+2.  The array is allocated once and only
+//	re-allocated (at twice the size) when it fills up, so putting
+//	items in and taking them out does no memory allocation.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+const int InitialHeapSize = 16;  // how many items do we start with room for?
+
+#include "copyright.h"
+
+//----------------------------------------------------------------------
+// Heap<T>::Heap
+//	Initialize a heap, empty to start with.
+//
+//	"comp" is the function used to order the items
+//	"pos" returns where in an item to keep its index in the heap,
+//		or is NULL if the items don't keep track of it
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::Heap(int (*comp)(T x, T y), int *(*pos)(T x)) {
+    compare = comp;
+    position = pos;
+    numInHeap = 0;
+    capacity = InitialHeapSize;
+    items = new T[capacity];
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::~Heap
+//	Prepare a heap for deallocation.
+//      This does *NOT* free the items still in the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::~Heap() {
+    delete[] items;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Place
+//	Store "item" at "index" in the heap array, and let the item
+//	know where it is, if it keeps track.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Place(T item, int index) {
+    items[index] = item;
+    if (position != NULL) {
+        *(*position)(item) = index;
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SiftUp
+//	Move the item at "index" towards the top of the heap, until it
+//	is no smaller than its parent.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SiftUp(int index) {
+    T item = items[index];
+
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (compare(items[parent], item) <= 0) {
+            break;
+        }
+        Place(items[parent], index);
+        index = parent;
+    }
+    Place(item, index);
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SiftDown
+//	Move the item at "index" towards the bottom of the heap, until
+//	it is no larger than either of its children.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SiftDown(int index) {
+    T item = items[index];
+
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= numInHeap) {
+            break;
+        }
+        if (child + 1 < numInHeap &&
+            compare(items[child + 1], items[child]) < 0) {
+            child++;  // the smaller of the two children
+        }
+        if (compare(item, items[child]) <= 0) {
+            break;
+        }
+        Place(items[child], index);
+        index = child;
+    }
+    Place(item, index);
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Insert
+//      Put an "item" in the heap, growing the array if it is full.
+//
+//	"item" is the thing to put in the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Insert(T item) {
+    if (numInHeap == capacity) {
+        T *bigger = new T[capacity * 2];
+        for (int i = 0; i < numInHeap; i++) {
+            bigger[i] = items[i];
+        }
+        delete[] items;
+        items = bigger;
+        capacity *= 2;
+    }
+    Place(item, numInHeap);
+    numInHeap++;
+    SiftUp(numInHeap - 1);
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::RemoveFront
+//      Remove the smallest item from the heap, and return it.
+//	The heap must not be empty.
+//----------------------------------------------------------------------
+
+template <class T>
+T Heap<T>::RemoveFront() {
+    T front;
+
+    ASSERT(!IsEmpty());
+    front = items[0];
+    numInHeap--;
+    if (numInHeap > 0) {
+        Place(items[numInHeap], 0);
+        SiftDown(0);
+    }
+    return front;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Find
+//      Return the index of "item" in the heap array, or -1 if it
+//	is not in the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+int Heap<T>::Find(T item) const {
+    if (position != NULL) {
+        int index = *(*position)(item);
+        if (index >= 0 && index < numInHeap && items[index] == item) {
+            return index;
+        }
+        return -1;
+    }
+    for (int i = 0; i < numInHeap; i++) {
+        if (items[i] == item) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Remove
+//      Remove "item" from the heap.  The item must be in the heap.
+//
+//	"item" is the thing to remove
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Remove(T item) {
+    int index = Find(item);
+    T last;
+
+    ASSERT(index >= 0);
+    numInHeap--;
+    if (index == numInHeap) {  // it was the last one
+        return;
+    }
+    // fill the hole with the last item, which may have to move
+    // either up or down from there
+    last = items[numInHeap];
+    Place(last, index);
+    if (index > 0 && compare(items[(index - 1) / 2], last) > 0) {
+        SiftUp(index);
+    } else {
+        SiftDown(index);
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::IsInHeap
+//      Return TRUE if the item is in the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+bool Heap<T>::IsInHeap(T item) const {
+    return Find(item) >= 0;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Apply
+//      Apply function to every item in the heap, smallest first.
+//	Meant for debugging: it sorts a copy of the heap, so it
+//	takes O(n^2) time.
+//
+//	"func" is the procedure to apply.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Apply(void (*func)(T)) const {
+    T *sorted = new T[numInHeap > 0 ? numInHeap : 1];
+    int i, j;
+
+    for (i = 0; i < numInHeap; i++) {  // insertion sort of a copy
+        for (j = i; j > 0 && compare(items[i], sorted[j - 1]) < 0; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = items[i];
+    }
+    for (i = 0; i < numInHeap; i++) {
+        (*func)(sorted[i]);
+    }
+    delete[] sorted;
+}
+
+//----------------------------------------------------------------------
+// Heap::SanityCheck
+//      Test whether this is still a legal heap.
+//
+//	Tests: is every item no larger than its children?
+//	       does every item know where it is?
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SanityCheck() const {
+    ASSERT(numInHeap >= 0 && numInHeap <= capacity);
+    for (int i = 1; i < numInHeap; i++) {
+        ASSERT(compare(items[(i - 1) / 2], items[i]) <= 0);
+    }
+    if (position != NULL) {
+        for (int i = 0; i < numInHeap; i++) {
+            ASSERT(*(*position)(items[i]) == i);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap::SelfTest
+//      Test whether this module is working.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SelfTest(T *p, int numEntries) {
+    int i;
+    T *q = new T[numEntries];
+
+    ASSERT(IsEmpty());
+    SanityCheck();
+
+    // put everything in, take everything out
+    for (i = 0; i < numEntries; i++) {
+        Insert(p[i]);
+        ASSERT(IsInHeap(p[i]));
+    }
+    SanityCheck();
+    for (i = 0; i < numEntries; i++) {
+        q[i] = RemoveFront();
+        ASSERT(!IsInHeap(q[i]));
+        SanityCheck();
+    }
+    ASSERT(IsEmpty());
+
+    // make sure everything came out in the right order
+    for (i = 0; i < (numEntries - 1); i++) {
+        ASSERT(compare(q[i], q[i + 1]) <= 0);
+    }
+
+    // removing from the middle should keep the heap in order
+    for (i = 0; i < numEntries; i++) {
+        Insert(p[i]);
+    }
+    for (i = 0; i < numEntries; i += 2) {
+        Remove(p[i]);
+        ASSERT(!IsInHeap(p[i]));
+        SanityCheck();
+    }
+    while (!IsEmpty()) {
+        RemoveFront();
+    }
+    SanityCheck();
+
+    delete[] q;
+}
@@ -0,0 +1,92 @@
+// heap.h
+//	Data structures to manage a priority queue, implemented as a
+//	binary min-heap stored in an array.
+//
+//	Like a SortedList, a heap always returns its smallest item first,
+//	but insertion and removal take O(log n) time instead of O(n),
+//	and no memory is allocated per item: the array only grows (by
+//	doubling) when it is full.  Allocation and deallocation of the
+//	items in the heap are to be done by the caller.
+//
+//	Items with equal keys come out in no particular order; callers
+//	that need FIFO order among equal items must break the tie in
+//	their comparison function.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "copyright.h"
+#include "debug.h"
+
+// The following class defines a "heap" of items.  All types
+// to be put in a heap must have a "Compare" function defined:
+//	   int Compare(T x, T y)
+//		returns -1 if x < y
+//		returns 0 if x == y
+//		returns 1 if x > y
+//
+// Removing an arbitrary item (rather than the smallest one) is
+// O(log n) only if the items can remember where they are in the heap.
+// For that, pass a "Position" function that returns a pointer to an
+// integer inside the item, which the heap keeps up to date; otherwise
+// Remove has to search the heap.
+
+template <class T>
+class Heap {
+   public:
+    Heap(int (*comp)(T x, T y), int *(*pos)(T x));
+    // initialize the heap
+    ~Heap();  // de-allocate the heap
+
+    void Insert(T item);  // Put item in the heap
+
+    T Front() {
+        ASSERT(numInHeap > 0);
+        return items[0];
+    }
+    // Return the smallest item
+    // without removing it
+    T RemoveFront();      // Take the smallest item out of the heap
+    void Remove(T item);  // Remove specific item from the heap
+
+    bool IsInHeap(T item) const;  // is the item in the heap?
+
+    int NumInHeap() { return numInHeap; }
+    // how many items in the heap?
+    bool IsEmpty() { return (numInHeap == 0); }
+    // is the heap empty?
+
+    void Apply(void (*f)(T)) const;
+    // apply function to all items in the
+    // heap, smallest first
+
+    void SanityCheck() const;
+    // has this heap been corrupted?
+    void SelfTest(T *p, int numEntries);
+    // verify module is working
+
+   private:
+    T *items;        // the heap: items[i] is no larger than
+                     // items[2i+1] and items[2i+2]
+    int numInHeap;   // number of items in the heap
+    int capacity;    // size of the "items" array
+    int (*compare)(T x, T y);  // function for ordering items
+    int *(*position)(T x);     // where an item stores its index,
+                               // NULL if items don't keep track
+
+    void Place(T item, int index);  // store an item at an index
+    void SiftUp(int index);         // restore heap order, moving
+    void SiftDown(int index);       // an item towards the top/bottom
+    int Find(T item) const;         // index of an item, or -1
+};
+
+#include "heap.cc"  // templates are really like macros
+    // so needs to be included in every
+    // file that uses the template
+#endif  // HEAP_H
@@ -1,6 +1,7 @@
 // libtest.cc
 //	Driver code to call self-test routines for standard library
-//	classes -- bitmaps, lists, sorted lists, and hash tables.
+//	classes -- bitmaps, lists, sorted lists, heaps, and hash tables.
+//	Also micro-benchmarks for some of them.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -11,6 +12,7 @@
 #include "bitmap.h"
 #include "copyright.h"
 #include "hash.h"
+#include "heap.h"
 #include "list.h"
 #include "sysdep.h"
 
@@ -57,6 +59,11 @@ HashKey(char *str) {
 // Array of values to be inserted into a List or SortedList.
 static int listTestVector[] = {9, 5, 7};
 
+// Array of values to be inserted into a Heap.
+// There are enough here to force the heap to grow.
+static int heapTestVector[] = {9, 5, 7, 23, 1, 18, 3, 12, 30, 2, 17, 8, 0,
+                               25, 14, 6, 11, 28, 4, 20};
+
 // Array of values to be inserted into the HashTable
 // There are enough here to force a ReHash().
 static char *hashTestVector[] = {"0", "1", "2", "3", "4", "5", "6",
@@ -64,7 +71,7 @@ static char *hashTestVector[] = {"0", "1", "2", "3", "4", "5", "6",
 
 //----------------------------------------------------------------------
 // LibSelfTest
-//	Run self tests on bitmaps, lists, sorted lists, and
+//	Run self tests on bitmaps, lists, sorted lists, heaps, and
 //	hash tables.
 //----------------------------------------------------------------------
 
@@ -72,16 +79,179 @@ void LibSelfTest() {
     Bitmap *map = new Bitmap(200);
     List<int> *list = new List<int>;
     SortedList<int> *sortList = new SortedList<int>(IntCompare);
+    Heap<int> *heap = new Heap<int>(IntCompare, NULL);
     HashTable<int, char *> *hashTable =
         new HashTable<int, char *>(HashKey, HashInt);
 
     map->SelfTest();
     list->SelfTest(listTestVector, sizeof(listTestVector) / sizeof(int));
     sortList->SelfTest(listTestVector, sizeof(listTestVector) / sizeof(int));
+    heap->SelfTest(heapTestVector, sizeof(heapTestVector) / sizeof(int));
     hashTable->SelfTest(hashTestVector, sizeof(hashTestVector) / sizeof(char *));
 
     delete map;
     delete list;
     delete sortList;
+    delete heap;
     delete hashTable;
 }
+
+// A stand-in for a PendingInterrupt, for the event queue benchmark.
+class BenchEvent {
+   public:
+    int when;       // when the event is due
+    int serial;     // order in which events were scheduled
+    int heapIndex;  // position in the heap
+};
+
+//----------------------------------------------------------------------
+// BenchCompare, BenchPosition
+//	Order benchmark events the way pending interrupts are ordered,
+//	and tell the heap where an event keeps its position.
+//----------------------------------------------------------------------
+
+static int
+BenchCompare(BenchEvent *x, BenchEvent *y) {
+    if (x->when != y->when)
+        return (x->when < y->when) ? -1 : 1;
+    if (x->serial != y->serial)
+        return (x->serial < y->serial) ? -1 : 1;
+    return 0;
+}
+
+static int *
+BenchPosition(BenchEvent *x) {
+    return &x->heapIndex;
+}
+
+//----------------------------------------------------------------------
+// BenchmarkEventQueues
+//	Time the SortedList that used to hold pending interrupts against
+//	the Heap that replaced it, on the same workload: "numPending"
+//	events are always outstanding, and each step takes the earliest
+//	one off and schedules it again a little later, the way devices
+//	re-arm themselves.
+//
+//	"numPending" -- how many events are outstanding
+//	"numSteps" -- how many events to pop and re-schedule
+//----------------------------------------------------------------------
+
+static void
+BenchmarkEventQueues(int numPending, int numSteps) {
+    BenchEvent *events = new BenchEvent[numPending];
+    int *delays = new int[numSteps];
+    SortedList<BenchEvent *> *list = new SortedList<BenchEvent *>(BenchCompare);
+    Heap<BenchEvent *> *heap = new Heap<BenchEvent *>(BenchCompare, BenchPosition);
+    unsigned int seed = 1;
+    double start, listTime, heapTime;
+    int i, serial;
+
+    // the same delays for both queues, without disturbing the
+    // kernel's random number generator
+    for (i = 0; i < numSteps; i++) {
+        seed = seed * 1103515245 + 12345;
+        delays[i] = 1 + (seed >> 16) % 500;
+    }
+
+    serial = 0;
+    for (i = 0; i < numPending; i++) {
+        events[i].when = delays[i % numSteps];
+        events[i].serial = serial++;
+        list->Insert(&events[i]);
+    }
+    start = HostTime();
+    for (i = 0; i < numSteps; i++) {
+        BenchEvent *next = list->RemoveFront();
+        next->when += delays[i];
+        next->serial = serial++;
+        list->Insert(next);
+    }
+    listTime = HostTime() - start;
+
+    serial = 0;
+    for (i = 0; i < numPending; i++) {
+        events[i].when = delays[i % numSteps];
+        events[i].serial = serial++;
+        heap->Insert(&events[i]);
+    }
+    start = HostTime();
+    for (i = 0; i < numSteps; i++) {
+        BenchEvent *next = heap->RemoveFront();
+        next->when += delays[i];
+        next->serial = serial++;
+        heap->Insert(next);
+    }
+    heapTime = HostTime() - start;
+
+    cout << "Event queue, " << numPending << " pending: ";
+    cout << "SortedList " << listTime * 1.0e9 / numSteps << " ns/event, ";
+    cout << "Heap " << heapTime * 1.0e9 / numSteps << " ns/event\n";
+
+    while (!list->IsEmpty())
+        list->RemoveFront();
+    delete list;
+    delete heap;
+    delete[] delays;
+    delete[] events;
+}
+
+//----------------------------------------------------------------------
+// BenchmarkBitmap
+//	Time allocation from a bitmap that is nearly full, the way the
+//	free sector map of a full disk is used: one bit in every
+//	"spacing" is clear, and each step sets the lowest clear bit, or
+//	the lowest run of 4, and clears it again elsewhere.
+//
+//	"numBits" -- how big the bitmap is
+//	"spacing" -- how far apart the clear bits are
+//	"numSteps" -- how many bits to set and clear
+//----------------------------------------------------------------------
+
+static void
+BenchmarkBitmap(int numBits, int spacing, int numSteps) {
+    Bitmap *map = new Bitmap(numBits);
+    double start, findTime, runTime;
+    int i, which, count;
+
+    for (i = 0; i < numBits; i++) {
+        if (i % spacing != spacing - 1) {
+            map->Mark(i);
+        }
+    }
+    start = HostTime();
+    for (i = 0; i < numSteps; i++) {
+        which = map->FindAndSet();
+        map->Clear(which);
+    }
+    findTime = HostTime() - start;
+
+    start = HostTime();
+    for (i = 0; i < numSteps; i++) {
+        which = map->FindAndSetRun(4, &count);
+        while (count > 0) {
+            map->Clear(which + --count);
+        }
+    }
+    runTime = HostTime() - start;
+
+    cout << "Bitmap, " << numBits << " bits, 1 in " << spacing << " clear: ";
+    cout << "FindAndSet " << findTime * 1.0e9 / numSteps << " ns, ";
+    cout << "FindAndSetRun(4) " << runTime * 1.0e9 / numSteps << " ns\n";
+    delete map;
+}
+
+//----------------------------------------------------------------------
+// LibBenchmark
+//	Run micro-benchmarks on library data structures, and print the
+//	results.
+//----------------------------------------------------------------------
+
+void LibBenchmark() {
+    BenchmarkEventQueues(4, 1000000);
+    BenchmarkEventQueues(16, 1000000);
+    BenchmarkEventQueues(64, 1000000);
+    BenchmarkEventQueues(256, 1000000);
+    BenchmarkBitmap(1024, 1024, 100000);
+    BenchmarkBitmap(1 << 20, 1 << 20, 1000);
+    BenchmarkBitmap(1 << 20, 1000, 1000);
+}
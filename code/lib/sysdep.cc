@@ -143,6 +143,19 @@ void UDelay(unsigned int useconds) {
     // #endif /* SOLARIS */
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the host's wall clock time, in seconds.  Used only to
+//	time benchmarks: it has nothing to do with simulated time.
+//----------------------------------------------------------------------
+
+double HostTime() {
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
@@ -27,6 +27,9 @@ extern void Exit(int exitCode);
 extern void Delay(int seconds);
 extern void UDelay(unsigned int usec);  // rcgood - to avoid spinners.
 
+// Host wall clock time in seconds, for timing benchmarks
+extern double HostTime();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(void (*cleanup)(int));
 
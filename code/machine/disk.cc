@@ -34,10 +34,11 @@ const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 //	if it doesn't exist), and check the magic number to make sure it's
 // 	ok to treat it as Nachos disk storage.
 //
+//	"name" -- the disk is stored in the UNIX file "name_<host id>"
 //	"toCall" -- object to call when disk read/write request completes
 //----------------------------------------------------------------------
 
-Disk::Disk(CallBackObj *toCall) {
+Disk::Disk(char *name, CallBackObj *toCall) {
     int magicNum;
     int tmp = 0;
 
@@ -46,7 +47,7 @@ Disk::Disk(CallBackObj *toCall) {
     lastSector = 0;
     bufferInit = 0;
 
-    sprintf(diskname, "DISK_%d", kernel->hostName);
+    sprintf(diskname, "%s_%d", name, kernel->hostName);
     fileno = OpenForReadWrite(diskname, FALSE);
     if (fileno >= 0) {  // file exists, check magic number
         Read(fileno, (char *)&magicNum, MagicSize);
@@ -94,11 +95,7 @@ PrintSector(bool writing, int sector, char *data) {
 
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
-// 	Simulate a request to read/write a single disk sector
-//	   Do the read/write immediately to the UNIX file
-//	   Set up an interrupt handler to be called later,
-//	      that will notify the caller when the simulator says
-//	      the operation has completed.
+// 	Simulate a request to read/write a single disk sector.
 //
 //	Note that a disk only allows an entire sector to be read/written,
 //	not part of a sector.
@@ -108,37 +105,67 @@ PrintSector(bool writing, int sector, char *data) {
 //----------------------------------------------------------------------
 
 void Disk::ReadRequest(int sectorNumber, char *data) {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    ReadSectors(sectorNumber, 1, data);
+}
+
+void Disk::WriteRequest(int sectorNumber, char *data) {
+    WriteSectors(sectorNumber, 1, data);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadSectors/WriteSectors
+// 	Simulate a request to read/write a run of consecutive disk sectors
+//	   Do the read/write immediately to the UNIX file
+//	   Set up an interrupt handler to be called later,
+//	      that will notify the caller when the simulator says
+//	      the operation has completed.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"numSectors" -- how many sectors
+//	"data" -- the bytes to be written, the buffer to hold the incoming
+//		bytes; numSectors * SectorSize of them
+//----------------------------------------------------------------------
+
+void Disk::ReadSectors(int sectorNumber, int numSectors, char *data) {
+    int ticks;
 
     ASSERT(!active);  // only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0) && (sectorNumber + numSectors <= NumSectors));
+    ticks = ComputeLatency(sectorNumber, FALSE) + RunTime(sectorNumber, numSectors);
 
-    DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
+    DEBUG(dbgDisk, "Reading " << numSectors << " sectors from sector " << sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
-    if (debug->IsEnabled('d'))
-        PrintSector(FALSE, sectorNumber, data);
+    Read(fileno, data, SectorSize * numSectors);
+    if (debug->IsEnabled('d')) {
+        for (int i = 0; i < numSectors; i++) {
+            PrintSector(FALSE, sectorNumber + i, data + i * SectorSize);
+        }
+    }
 
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, numSectors, ticks);
     kernel->stats->numDiskReads++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
-void Disk::WriteRequest(int sectorNumber, char *data) {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+void Disk::WriteSectors(int sectorNumber, int numSectors, char *data) {
+    int ticks;
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0) && (sectorNumber + numSectors <= NumSectors));
+    ticks = ComputeLatency(sectorNumber, TRUE) + RunTime(sectorNumber, numSectors);
 
-    DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
+    DEBUG(dbgDisk, "Writing " << numSectors << " sectors to sector " << sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
-    if (debug->IsEnabled('d'))
-        PrintSector(TRUE, sectorNumber, data);
+    WriteFile(fileno, data, SectorSize * numSectors);
+    if (debug->IsEnabled('d')) {
+        for (int i = 0; i < numSectors; i++) {
+            PrintSector(TRUE, sectorNumber + i, data + i * SectorSize);
+        }
+    }
 
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, numSectors, ticks);
     kernel->stats->numDiskWrites++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
@@ -232,18 +259,40 @@ int Disk::ComputeLatency(int newSector, bool writing) {
     return (seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::RunTime()
+// 	Return how much longer a request for a run of sectors takes than
+//	one for just the first of them: the transfer time of the rest, and
+//	a seek of one track each time the run goes on to the next track.
+//----------------------------------------------------------------------
+
+int Disk::RunTime(int sectorNumber, int numSectors) {
+    int lastSector = sectorNumber + numSectors - 1;
+    int tracks = lastSector / SectorsPerTrack - sectorNumber / SectorsPerTrack;
+
+    return (numSectors - 1) * RotationTime + tracks * SeekTime;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
-//	what is in the track buffer.
+//	what is in the track buffer.  For a run of sectors, that is the
+//	last; if the run goes on to another track, the track buffer is
+//	loaded from when the head gets to that track.
+//
+//	"newSector", "numSectors" -- the run of sectors requested
+//	"ticks" -- how long the request takes
 //----------------------------------------------------------------------
 
-void Disk::UpdateLast(int newSector) {
+void Disk::UpdateLast(int newSector, int numSectors, int ticks) {
     int rotate;
     int seek = TimeToSeek(newSector, &rotate);
+    int last = newSector + numSectors - 1;
 
     if (seek != 0)
         bufferInit = kernel->stats->totalTicks + seek + rotate;
-    lastSector = newSector;
+    if (last / SectorsPerTrack != newSector / SectorsPerTrack)
+        bufferInit = kernel->stats->totalTicks + ticks - (last % SectorsPerTrack + 1) * RotationTime;
+    lastSector = last;
     DEBUG(dbgDisk, "Updating last sector = " << lastSector << " , " << bufferInit);
 }
@@ -46,6 +46,11 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// A request can also be for a run of consecutive sectors.  It costs one
+// seek and rotational delay to get to the first, and then one sector's
+// transfer time for each; we assume the tracks are skewed, so that going
+// on to the next track costs only the seek to it.
 
 const int SectorSize = 128;      // number of bytes per disk sector
 const int SectorsPerTrack = 32;  // number of sectors per disk track
@@ -55,9 +60,9 @@ const int NumSectors = (SectorsPerTrack * NumTracks);
 
 class Disk : public CallBackObj {
    public:
-    Disk(CallBackObj *toCall);  // Create a simulated disk.
-                                // Invoke toCall->CallBack()
-                                // when each request completes.
+    Disk(char *name, CallBackObj *toCall);  // Create a simulated disk.
+                                            // Invoke toCall->CallBack()
+                                            // when each request completes.
     ~Disk();                    // Deallocate the disk.
 
     void ReadRequest(int sectorNumber, char *data);
@@ -67,6 +72,12 @@ class Disk : public CallBackObj {
     // Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char *data);
 
+    void ReadSectors(int sectorNumber, int numSectors, char *data);
+    void WriteSectors(int sectorNumber, int numSectors, char *data);
+    // Read/write "numSectors" consecutive
+    // sectors, starting at sectorNumber,
+    // as one request
+
     void CallBack();  // Invoked when disk request
                       // finishes. In turn calls, callWhenDone.
 
@@ -86,7 +97,10 @@ class Disk : public CallBackObj {
 
     int TimeToSeek(int newSector, int *rotate);  // time to get to the new track
     int ModuloDiff(int to, int from);            // # sectors between to and from
-    void UpdateLast(int newSector);
+    int RunTime(int sectorNumber, int numSectors);
+    // time to go on from the first sector
+    // of a run to the end of the last
+    void UpdateLast(int newSector, int numSectors, int ticks);
 };
 
 #endif  // DISK_H
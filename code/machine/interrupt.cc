@@ -22,9 +22,12 @@
 
 #include "interrupt.h"
 
+#include "buffercache.h"
 #include "copyright.h"
 #include "main.h"
 
+#include <limits.h>
+
 // String definitions for debugging messages
 
 static char *intLevelNames[] = {"off", "on"};
@@ -47,11 +50,16 @@ PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt,
     callOnInterrupt = callOnInt;
     when = time;
     type = kind;
+    serial = 0;
+    heapIndex = -1;
+    nextFree = NULL;
 }
 
 //----------------------------------------------------------------------
 // PendingCompare
 //	Compare to interrupts based on which should occur first.
+//	Interrupts due at the same time occur in the order they were
+//	scheduled.
 //----------------------------------------------------------------------
 
 static int
@@ -60,11 +68,26 @@ PendingCompare(PendingInterrupt *x, PendingInterrupt *y) {
         return -1;
     } else if (x->when > y->when) {
         return 1;
+    } else if (x->serial < y->serial) {
+        return -1;
+    } else if (x->serial > y->serial) {
+        return 1;
     } else {
         return 0;
     }
 }
 
+//----------------------------------------------------------------------
+// PendingPosition
+//	Tell the pending heap where an interrupt keeps its position,
+//	so that it can be cancelled without searching.
+//----------------------------------------------------------------------
+
+static int *
+PendingPosition(PendingInterrupt *x) {
+    return &x->heapIndex;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Interrupt
 // 	Initialize the simulation of hardware device interrupts.
@@ -74,7 +97,11 @@ PendingCompare(PendingInterrupt *x, PendingInterrupt *y) {
 
 Interrupt::Interrupt() {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    pending = new Heap<PendingInterrupt *>(PendingCompare, PendingPosition);
+    freePending = NULL;
+    numScheduled = 0;
+    nextEventTick = INT_MAX;
+    traceTicks = debug->IsEnabled(dbgInt);
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -90,6 +117,11 @@ Interrupt::~Interrupt() {
         delete pending->RemoveFront();
     }
     delete pending;
+    while (freePending != NULL) {
+        PendingInterrupt *next = freePending->nextFree;
+        delete freePending;
+        freePending = next;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -156,6 +188,13 @@ void Interrupt::OneTick() {
     }
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
 
+    // Nothing is due before nextEventTick, so unless the interrupt
+    // state is being traced, there is no need to disable interrupts
+    // and look at the pending list.
+    if (stats->totalTicks < nextEventTick && !traceTicks && !yieldOnReturn) {
+        return;
+    }
+
     // check any pending interrupts are now ready to fire
     ChangeLevel(IntOn, IntOff);  // first, turn off interrupts
                                  // (interrupt handlers run with
@@ -226,6 +265,12 @@ void Interrupt::Idle() {
 // 	Shut down Nachos cleanly, printing out performance statistics.
 //----------------------------------------------------------------------
 void Interrupt::Halt() {
+    // what is only in memory is lost otherwise
+#ifdef FILESYS_STUB
+    kernel->bufferCache->Sync();
+#else
+    kernel->fileSystem->Sync();
+#endif
 #ifndef NO_HALT_STAT
     cout << "Machine halting!\n\n";
     cout << "This is halt\n";
@@ -276,24 +321,93 @@ Interrupt::CloseFile(OpenFileId id)
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it in a heap ordered by time.  The
+//	PendingInterrupt records are recycled through a free pool, so
+//	scheduling an interrupt doesn't allocate memory once the pool
+//	is big enough.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
 //
+//	Returns the scheduled interrupt, which can be passed to Cancel
+//	until the interrupt occurs.
+//
 //	"toCall" is the object to call when the interrupt occurs
 //	"fromNow" is how far in the future (in simulated time) the
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
-void Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type) {
+
+PendingInterrupt *
+Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type) {
     int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
+    PendingInterrupt *toOccur;
+
+    if (freePending != NULL) {
+        toOccur = freePending;
+        freePending = toOccur->nextFree;
+        toOccur->callOnInterrupt = toCall;
+        toOccur->when = when;
+        toOccur->type = type;
+    } else {
+        toOccur = new PendingInterrupt(toCall, when, type);
+    }
+    toOccur->serial = numScheduled++;
 
     DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type] << " at time = " << when);
     ASSERT(fromNow > 0);
 
     pending->Insert(toOccur);
+    if (when < nextEventTick) {
+        nextEventTick = when;
+    }
+    return toOccur;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Take back an interrupt that was scheduled but has not occurred
+//	yet, for instance because the device was reset.
+//
+//	"toCancel" is the interrupt, as returned by Schedule
+//----------------------------------------------------------------------
+
+void Interrupt::Cancel(PendingInterrupt *toCancel) {
+    DEBUG(dbgInt, "Cancelling interrupt handler the " << intTypeNames[toCancel->type] << " at time = " << toCancel->when);
+    pending->Remove(toCancel);
+    FreePending(toCancel);
+    UpdateNextEvent();
+}
+
+//----------------------------------------------------------------------
+// Interrupt::FreePending
+// 	Put an interrupt that has occurred (or been cancelled) back in
+//	the pool, for Schedule to reuse.
+//----------------------------------------------------------------------
+
+void Interrupt::FreePending(PendingInterrupt *done) {
+    done->heapIndex = -1;
+    done->nextFree = freePending;
+    freePending = done;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::UpdateNextEvent
+// 	Recompute nextEventTick, the simulated time at which the earliest
+//	scheduled interrupt is due, after the pending list has changed.
+//	Nothing can happen before then, other than what the running
+//	thread does itself, so OneTick and the CPU simulation can skip
+//	checking for interrupts until that time.
+//
+//	If nothing is scheduled, nextEventTick is the largest possible time.
+//----------------------------------------------------------------------
+
+void Interrupt::UpdateNextEvent() {
+    if (pending->IsEmpty()) {
+        nextEventTick = INT_MAX;
+    } else {
+        nextEventTick = pending->Front()->when;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -341,13 +455,14 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
 
     inHandler = TRUE;
     do {
-        next = pending->RemoveFront();  // pull interrupt off list
+        next = pending->RemoveFront();  // pull interrupt off the heap
         DEBUG(dbgTraCode, "In Interrupt::CheckIfDue, into callOnInterrupt->CallBack, " << stats->totalTicks);
         next->callOnInterrupt->CallBack();  // call the interrupt handler
         DEBUG(dbgTraCode, "In Interrupt::CheckIfDue, return from callOnInterrupt->CallBack, " << stats->totalTicks);
-        delete next;
+        FreePending(next);
     } while (!pending->IsEmpty() && (pending->Front()->when <= stats->totalTicks));
     inHandler = FALSE;
+    UpdateNextEvent();
     return TRUE;
 }
 
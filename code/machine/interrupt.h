@@ -35,7 +35,7 @@
 
 #include "callback.h"
 #include "copyright.h"
-#include "list.h"
+#include "heap.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus { IntOff,
@@ -75,6 +75,11 @@ class PendingInterrupt {
 
     int when;      // When the interrupt is supposed to fire
     IntType type;  // for debugging
+
+    int serial;      // order in which interrupts were scheduled,
+                     // to fire interrupts due at the same time FIFO
+    int heapIndex;   // where this interrupt is in the pending heap
+    PendingInterrupt *nextFree;  // next unused interrupt in the pool
 };
 
 // The following class defines the data structures for the simulation
@@ -125,18 +130,32 @@ class Interrupt {
     // but they need to be public since they are called by the
     // hardware device simulators.
 
-    void Schedule(CallBackObj *callTo, int when, IntType type);
+    PendingInterrupt *Schedule(CallBackObj *callTo, int when, IntType type);
     // Schedule an interrupt to occur
     // at time "when".  This is called
     // by the hardware device simulators.
 
+    void Cancel(PendingInterrupt *toCancel);
+    // Take back an interrupt that has been
+    // scheduled but has not occurred yet.
+
     void OneTick();  // Advance simulated time
 
+    int NextEventTick() { return nextEventTick; }
+    // Time at which the next scheduled
+    // interrupt is due
+
    private:
     IntStatus level;  // are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;
-    // the list of interrupts scheduled
+    Heap<PendingInterrupt *> *pending;
+    // the interrupts scheduled
     // to occur in the future
+    PendingInterrupt *freePending;  // pool of unused interrupts
+    int numScheduled;               // serial number for the next one
+    int nextEventTick;  // when the first interrupt in
+                        // "pending" is due
+    bool traceTicks;    // print the interrupt state
+                        // on every tick
     // int writeFileNo;            //UNIX file emulating the display
     bool inHandler;  // TRUE if we are running an interrupt handler
     // bool putBusy;               // Is a PrintInt operation in progress
@@ -151,6 +170,11 @@ class Interrupt {
     // Check if any interrupts are supposed
     // to occur now, and if so, do them
 
+    void UpdateNextEvent();  // recompute nextEventTick
+
+    void FreePending(PendingInterrupt *done);
+    // return an interrupt to the pool
+
     void ChangeLevel(IntStatus old,   // SetLevel, without advancing the
                      IntStatus now);  // simulated time
 };
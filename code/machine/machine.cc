@@ -19,6 +19,11 @@ static char* exceptionNames[] = {"no exception", "syscall",
                                  "bus error", "address error", "overflow",
                                  "illegal instruction", "memory limit"};
 
+// The size of physical memory; see machine.h.
+int PageSize = DefaultPageSize;
+int NumPhysPages = DefaultNumPhysPages;
+int MemorySize = DefaultNumPhysPages * DefaultPageSize;
+
 //----------------------------------------------------------------------
 // CheckEndian
 // 	Check to be sure that the host really uses the format it says it
@@ -49,27 +54,65 @@ static void CheckEndian() {
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"useBlocks" -- if TRUE, run user code a basic block at a time
+//	"numTLBEntries" -- if non-zero, translate through a TLB of this
+//		many entries instead of a page table
+//	"tlbAssoc" -- the number of entries in each set of the TLB
+//	"pageSize" -- the number of bytes in a page (a multiple of 4)
+//	"numPhysPages" -- the number of pages of physical memory
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug) {
+Machine::Machine(bool debug, bool useBlocks, int numTLBEntries, int tlbAssoc,
+                 int pageSize, int numPhysPages) {
     int i;
 
+    ASSERT(pageSize > 0 && pageSize % 4 == 0 && numPhysPages > 0);
+    PageSize = pageSize;
+    NumPhysPages = numPhysPages;
+    MemorySize = numPhysPages * pageSize;
+
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
         mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-        tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else  // use linear page table
-    tlb = NULL;
+    decodeCache = new Instruction[MemorySize / 4];
+    blockLength = new int[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++) {
+        decodeCache[i].opCode = 0;
+        blockLength[i] = 0;
+    }
+    pageDecoded = new bool[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+        pageDecoded[i] = FALSE;
+    xlateCache = new XlateEntry[XlateCacheSize];
+    FlushTranslations();
+    // "debug" is our argument; TLB statistics need every lookup
+    useXlateCache = !::debug->IsEnabled(dbgAddr) && numTLBEntries == 0;
+    tlbSize = numTLBEntries;
+    tlbWays = tlbAssoc;
+    tlbUseCount = 0;
+    currentASID = 0;
+    if (tlbSize > 0) {
+        ASSERT(tlbWays > 0 && tlbSize % tlbWays == 0);
+        tlb = new TranslationEntry[tlbSize];
+        tlbASID = new int[tlbSize];
+        tlbLastUse = new unsigned int[tlbSize];
+        for (i = 0; i < tlbSize; i++) {
+            tlb[i].valid = FALSE;
+            tlbASID[i] = 0;
+            tlbLastUse[i] = 0;
+        }
+    } else {  // use linear page table
+        tlb = NULL;
+        tlbASID = NULL;
+        tlbLastUse = NULL;
+    }
     pageTable = NULL;
-#endif
 
     singleStep = debug;
+    blockMode = useBlocks;
+    batchTicks = 0;
     CheckEndian();
 }
 
@@ -80,8 +123,50 @@ Machine::Machine(bool debug) {
 
 Machine::~Machine() {
     delete[] mainMemory;
-    if (tlb != NULL)
+    delete[] decodeCache;
+    delete[] blockLength;
+    delete[] pageDecoded;
+    delete[] xlateCache;
+    if (tlb != NULL) {
         delete[] tlb;
+        delete[] tlbASID;
+        delete[] tlbLastUse;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslations
+// 	Forget all the address translations cached by ReadMem, WriteMem
+//	and instruction fetch, because the page table or TLB they came
+//	from has been switched or changed.
+//----------------------------------------------------------------------
+
+void Machine::FlushTranslations() {
+    for (int i = 0; i < XlateCacheSize; i++) {
+        xlateCache[i].readPage = -1;
+        xlateCache[i].writePage = -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodedPage
+// 	Throw away the predecoded instructions cached for one page of
+//	physical memory, because its contents have changed.  The entries
+//	are decoded again the next time they are fetched.
+//
+//	"physPage" -- the physical page number
+//----------------------------------------------------------------------
+
+void Machine::InvalidateDecodedPage(int physPage) {
+    int first = physPage * PageSize / 4;
+
+    if (!pageDecoded[physPage])
+        return;
+    for (int i = 0; i < PageSize / 4; i++) {
+        decodeCache[first + i].opCode = 0;
+        blockLength[first + i] = 0;
+    }
+    pageDecoded[physPage] = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -96,6 +181,12 @@ Machine::~Machine() {
 
 void Machine::RaiseException(ExceptionType which, int badVAddr) {
     DEBUG(dbgMach, "Exception: " << exceptionNames[which]);
+    if (batchTicks > 0) {  // charge for the instructions run so far
+                           // in the current batch
+        kernel->stats->totalTicks += batchTicks * UserTick;
+        kernel->stats->userTicks += batchTicks * UserTick;
+        batchTicks = 0;
+    }
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);  // finish anything in progress
     kernel->interrupt->setStatus(SystemMode);
@@ -27,17 +27,20 @@
 
 // Definitions related to the size, and format of user memory
 
-const int PageSize = 128;  // set the page size equal to
-                           // the disk sector size, for simplicity
+const int DefaultPageSize = 128;  // set the page size equal to
+                                  // the disk sector size, for simplicity
 
 //
-// You are allowed to change this value.
-// Doing so will change the number of pages of physical memory
-// available on the simulated machine.
+// The page size and the number of pages of physical memory
+// available on the simulated machine can be changed on the command
+// line (-ps, -pm).  These are the sizes used if they aren't.
 //
-const int NumPhysPages = 128;
+const int DefaultNumPhysPages = 128;
 
-const int MemorySize = (NumPhysPages * PageSize);
+extern int PageSize;      // bytes in a page
+extern int NumPhysPages;  // pages of physical memory
+extern int MemorySize;    // bytes of physical memory
+                          // (all set when the Machine is created)
 const int TLBSize = 4;  // if there is a TLB, make it small
 
 enum ExceptionType { NoException,            // Everything ok!
@@ -89,13 +92,56 @@ enum ExceptionType { NoException,            // Everything ok!
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
-class Instruction;
 class Interrupt;
 
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+//
+// An opCode of 0 marks an entry of the predecoded instruction cache
+// that has not been filled in yet.
+
+class Instruction {
+   public:
+    void Decode();  // decode the binary representation of the instruction
+
+    unsigned int value;  // binary representation of the instruction
+
+    char opCode;      // Type of instruction.  This is NOT the same as the
+                      // opcode field from the instruction: see defs in mips.h
+    char rs, rt, rd;  // Three registers from instruction.
+    int extra;        // Immediate or target or shamt field or offset.
+                      // Immediates are sign-extended.
+};
+
+// The simulator keeps a small direct-mapped cache of recent address
+// translations, indexed by virtual page number, so that most loads,
+// stores and instruction fetches skip Machine::Translate.  This is
+// not part of the simulated hardware: it is invisible to user
+// programs, but the kernel must call Machine::FlushTranslations
+// whenever it changes the page table, the TLB, or the use/dirty bits
+// (which are only set when an entry is filled in).
+
+const int XlateCacheSize = 64;  // number of cached translations
+
+class XlateEntry {
+   public:
+    int readPage;   // virtual page that can be read through this
+                    // entry, or -1
+    int writePage;  // virtual page that can be written through this
+                    // entry (always readPage, or -1)
+    int physPage;   // the physical page it is mapped to
+};
+
 class Machine {
    public:
-    Machine(bool debug);  // Initialize the simulation of the hardware
-                          // for running user programs
+    Machine(bool debug, bool useBlocks, int numTLBEntries, int tlbAssoc,
+            int pageSize, int numPhysPages);
+    // Initialize the simulation of the
+    // hardware for running user programs
     ~Machine();           // De-allocate the data structures
 
     // Routines callable by the Nachos kernel
@@ -133,8 +179,23 @@ class Machine {
     // Thus the TLB pointer should be considered as *read-only*, although
     // the contents of the TLB are free to be modified by the kernel software.
 
+    //
+    // The TLB is set associative: the entries for virtual page "vpn"
+    // can only be in set (vpn % (tlbSize / tlbWays)), which is entries
+    // [set * tlbWays, (set + 1) * tlbWays).  Each entry is tagged with
+    // the address space (ASID) it belongs to, and only matches while
+    // currentASID is the same, so the TLB need not be flushed on a
+    // context switch.
+
     TranslationEntry *tlb;  // this pointer should be considered
                             // "read-only" to Nachos kernel code
+    int *tlbASID;           // address space of each TLB entry
+    unsigned int *tlbLastUse;  // when each TLB entry was last matched
+                               // (compare with tlbUseCount)
+    unsigned int tlbUseCount;  // number of TLB lookups so far
+    int tlbSize;               // number of entries in the TLB
+    int tlbWays;               // number of entries in each set
+    int currentASID;           // address space now running
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
@@ -145,7 +206,16 @@ class Machine {
     // memory (at addr).  Return FALSE if a
     // correct translation couldn't be found.
 
-  
+    void FlushTranslations();
+    // Forget all cached address translations
+
+    void InvalidateDecodedPage(int physPage);
+    // Forget any predecoded instructions from
+    // physical page "physPage".  The kernel must
+    // call this whenever it writes into a frame
+    // directly, or gives the frame to a new
+    // address space.
+
    private:
     // Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);
@@ -154,6 +224,36 @@ class Machine {
     void OneInstruction(Instruction *instr);
     // Run one instruction of a user program.
 
+    bool ExecuteInstruction(Instruction *instr);
+    // Execute an already decoded instruction.
+
+    Instruction *DecodedAt(int physAddr);
+    // Look up (or fill in) the predecoded
+    // instruction cache entry for a word of memory
+
+    bool FetchInstruction(Instruction *instr);
+    // Fetch and decode the instruction at the
+    // PC, using the predecoded instruction cache
+
+    int BatchLimit();
+    // How many instructions can run before
+    // the next interrupt is due
+
+    void EndBatch(bool trapped);
+    // Charge simulated time for a batch of
+    // instructions, and call OneTick
+
+    void RunUntilEvent(Instruction *instr);
+    // Run instructions up to the next interrupt,
+    // charging simulated time for them in one step.
+
+    void RunBlock();
+    // Run the basic block at the PC, charging
+    // simulated time for it in one step.
+
+    Instruction *FetchBlock(int *length);
+    // Find (or build) the basic block at the PC
+
     ExceptionType Translate(int virtAddr, int *physAddr, int size, bool writing);
     // Translate an address, and check for
     // alignment.  Set the use and dirty bits in
@@ -161,6 +261,21 @@ class Machine {
     // and return an exception code if the
     // translation couldn't be completed.
 
+    bool CachedTranslate(int virtAddr, int *physAddr, int size, bool writing) {
+        unsigned int vpn = (unsigned)virtAddr / PageSize;
+        XlateEntry *entry = &xlateCache[vpn % XlateCacheSize];
+        if ((writing ? entry->writePage : entry->readPage) != (int)vpn ||
+            (virtAddr & (size - 1)) != 0) {
+            return FALSE;
+        }
+        *physAddr = entry->physPage * PageSize + (unsigned)virtAddr % PageSize;
+        return TRUE;
+    }
+    // Translate an address using only the
+    // translation cache; return FALSE on a miss
+    // (or an unaligned access), in which case
+    // Translate must be called
+
     void RaiseException(ExceptionType which, int badVAddr);
     // Trap to the Nachos kernel, because of a
     // system call or other exception.
@@ -172,6 +287,22 @@ class Machine {
 
     int registers[NumTotalRegs];  // CPU registers, for executing user programs
 
+    Instruction *decodeCache;  // predecoded instructions, one entry
+                               // for each word of mainMemory
+    bool *pageDecoded;         // TRUE if some entry of decodeCache
+                               // for this physical page is filled in
+    int *blockLength;          // if non-zero, the length of the basic
+                               // block starting at this word
+
+    XlateEntry *xlateCache;  // recently used translations
+    bool useXlateCache;      // FALSE if address translation is being
+                             // traced, so that every access goes
+                             // through Translate
+
+    bool blockMode;  // run user code a basic block at a time
+    int batchTicks;  // instructions run in the current batch
+                     // that have not been charged for yet
+
     bool singleStep;   // drop back into the debugger after each
                        // simulated instruction
     int runUntilTime;  // drop back into the debugger when simulated
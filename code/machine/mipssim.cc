@@ -23,26 +23,6 @@
 
 static void Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr);
 
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-   public:
-    void Decode();  // decode the binary representation of the instruction
-
-    unsigned int value;  // binary representation of the instruction
-
-    char opCode;      // Type of instruction.  This is NOT the same as the
-                      // opcode field from the instruction: see defs in mips.h
-    char rs, rt, rd;  // Three registers from instruction.
-    int extra;        // Immediate or target or shamt field or offset.
-                      // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -53,12 +33,25 @@ class Instruction {
 //----------------------------------------------------------------------
 void Machine::Run() {
     Instruction *instr = new Instruction;  // storage for decoded instruction
+    bool batched;
+
     if (debug->IsEnabled('m')) {
         cout << "Starting program in thread: " << kernel->currentThread->getName();
         cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
+    // traces that report every instruction or tick need the
+    // instruction-at-a-time loop
+    batched = !debug->IsEnabled('m') && !debug->IsEnabled(dbgInt) &&
+              !debug->IsEnabled(dbgTraCode);
     kernel->interrupt->setStatus(UserMode);
     for (;;) {
+        if (batched && !singleStep) {
+            if (blockMode)
+                RunBlock();
+            else
+                RunUntilEvent(instr);
+            continue;
+        }
         DEBUG(dbgTraCode, "In Machine::Run(), into OneInstruction "
                               << "== Tick " << kernel->stats->totalTicks << " ==");
         OneInstruction(instr);
@@ -75,6 +68,110 @@ void Machine::Run() {
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::BatchLimit
+// 	Return how many user instructions can be run, starting now,
+//	without calling OneTick in between: the last one of them brings
+//	the clock up to the next scheduled interrupt.  Always at least one.
+//----------------------------------------------------------------------
+
+int Machine::BatchLimit() {
+    int ticksLeft = kernel->interrupt->NextEventTick() - kernel->stats->totalTicks;
+    int limit = (ticksLeft + UserTick - 1) / UserTick;
+
+    return (limit < 1) ? 1 : limit;
+}
+
+//----------------------------------------------------------------------
+// Machine::EndBatch
+// 	Charge simulated time for a batch of instructions that were run
+//	without calling OneTick after each one.
+//
+//	The last instruction of the batch (or the one that trapped) is
+//	charged by OneTick, which also fires any interrupt that is now
+//	due; instructions before a trap were already charged by
+//	RaiseException.  This keeps the clock, and the time at which
+//	every interrupt fires, the same as in the instruction-at-a-time
+//	loop.
+//
+//	"trapped" -- TRUE if the batch ended because of an exception
+//----------------------------------------------------------------------
+
+void Machine::EndBatch(bool trapped) {
+    Statistics *stats = kernel->stats;
+
+    if (!trapped)
+        batchTicks--;
+    stats->totalTicks += batchTicks * UserTick;
+    stats->userTicks += batchTicks * UserTick;
+    batchTicks = 0;
+    kernel->interrupt->OneTick();
+}
+
+//----------------------------------------------------------------------
+// Machine::RunUntilEvent
+// 	Run user instructions one at a time, up to the tick at which the
+//	next interrupt is due, with no per-tick bookkeeping in between.
+//
+//	"instr" -- storage for the decoded instruction
+//----------------------------------------------------------------------
+
+void Machine::RunUntilEvent(Instruction *instr) {
+    int limit = BatchLimit();
+    bool trapped = FALSE;
+
+    batchTicks = 0;
+    for (int count = 0; count < limit; count++) {
+        if (!FetchInstruction(instr) || !ExecuteInstruction(instr)) {
+            trapped = TRUE;
+            break;
+        }
+        batchTicks++;
+    }
+    EndBatch(trapped);
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Execute the basic block starting at the current PC, and charge
+//	simulated time for the whole block at once.
+//
+//	The block is cut short so that it never runs past the tick at
+//	which the next interrupt is due (see BatchLimit).  Control also
+//	leaves the block early if an instruction raises an exception, or
+//	if a store overwrites the block.
+//
+//	Like OneInstruction, this routine keeps no state across an
+//	exception other than the machine registers.
+//----------------------------------------------------------------------
+
+void Machine::RunBlock() {
+    int start = registers[PCReg];
+    Instruction *block;
+    int length, count;
+    bool trapped = FALSE;
+
+    block = FetchBlock(&length);
+    if (block == NULL) {  // exception occurred
+        kernel->interrupt->OneTick();
+        return;
+    }
+    if (length > BatchLimit())
+        length = BatchLimit();
+
+    batchTicks = 0;
+    for (count = 0; count < length; count++) {
+        if (block[count].opCode == 0 || registers[PCReg] != start + count * 4)
+            break;  // the block was overwritten, or control left it
+        if (!ExecuteInstruction(&block[count])) {
+            trapped = TRUE;
+            break;
+        }
+        batchTicks++;
+    }
+    EndBatch(trapped);
+}
+
 //----------------------------------------------------------------------
 // TypeToReg
 // 	Retrieve the register # referred to in an instruction.
@@ -120,21 +217,33 @@ TypeToReg(RegType reg, Instruction *instr) {
 //----------------------------------------------------------------------
 
 void Machine::OneInstruction(Instruction *instr) {
+    // Fetch instruction
+    if (!FetchInstruction(instr))
+        return;  // exception occurred
+
+    ExecuteInstruction(instr);
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Execute one decoded instruction, and advance the PC past it.
+//
+//	Returns FALSE if the instruction raised an exception; in that case
+//	the exception handler has already run, and the PC is whatever
+//	the kernel left it as.
+//
+//	"instr" -- the decoded instruction at the current PC
+//----------------------------------------------------------------------
+
+bool Machine::ExecuteInstruction(Instruction *instr) {
 #ifdef SIM_FIX
     int byte;  // described in Kane for LWL,LWR,...
 #endif
 
-    int raw;
     int nextLoadReg = 0;
     int nextLoadValue = 0;  // record delayed load operation, to apply
                             // in the future
 
-    // Fetch instruction
-    if (!ReadMem(registers[PCReg], 4, &raw))
-        return;  // exception occurred
-    instr->value = raw;
-    instr->Decode();
-
     if (debug->IsEnabled('m')) {
         struct OpString *str = &opStrings[instr->opCode];
         char buf[80];
@@ -158,7 +267,7 @@ void Machine::OneInstruction(Instruction *instr) {
             if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
                 ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
                 RaiseException(OverflowException, 0);
-                return;
+                return FALSE;
             }
             registers[instr->rd] = sum;
             break;
@@ -168,7 +277,7 @@ void Machine::OneInstruction(Instruction *instr) {
             if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
                 ((instr->extra ^ sum) & SIGN_BIT)) {
                 RaiseException(OverflowException, 0);
-                return;
+                return FALSE;
             }
             registers[instr->rt] = sum;
             break;
@@ -263,7 +372,7 @@ void Machine::OneInstruction(Instruction *instr) {
         case OP_LBU:
             tmp = registers[instr->rs] + instr->extra;
             if (!ReadMem(tmp, 1, &value))
-                return;
+                return FALSE;
 
             if ((value & 0x80) && (instr->opCode == OP_LB))
                 value |= 0xffffff00;
@@ -278,10 +387,10 @@ void Machine::OneInstruction(Instruction *instr) {
             tmp = registers[instr->rs] + instr->extra;
             if (tmp & 0x1) {
                 RaiseException(AddressErrorException, tmp);
-                return;
+                return FALSE;
             }
             if (!ReadMem(tmp, 2, &value))
-                return;
+                return FALSE;
 
             if ((value & 0x8000) && (instr->opCode == OP_LH))
                 value |= 0xffff0000;
@@ -300,10 +409,10 @@ void Machine::OneInstruction(Instruction *instr) {
             tmp = registers[instr->rs] + instr->extra;
             if (tmp & 0x3) {
                 RaiseException(AddressErrorException, tmp);
-                return;
+                return FALSE;
             }
             if (!ReadMem(tmp, 4, &value))
-                return;
+                return FALSE;
             nextLoadReg = instr->rt;
             nextLoadValue = value;
             break;
@@ -323,7 +432,7 @@ void Machine::OneInstruction(Instruction *instr) {
             // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
             if (!ReadMem(tmp - byte, 4, &value))
-                return;
+                return FALSE;
 #else
             // ReadMem assumes all 4 byte requests are aligned on an even
             // word boundary.  Also, the little endian/big endian swap code would
@@ -331,7 +440,7 @@ void Machine::OneInstruction(Instruction *instr) {
             ASSERT((tmp & 0x3) == 0);
 
             if (!ReadMem(tmp, 4, &value))
-                return;
+                return FALSE;
 #endif
 
             if (registers[LoadReg] == instr->rt)
@@ -375,7 +484,7 @@ void Machine::OneInstruction(Instruction *instr) {
             // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
             if (!ReadMem(tmp - byte, 4, &value))
-                return;
+                return FALSE;
 #else
             // ReadMem assumes all 4 byte requests are aligned on an even
             // word boundary.  Also, the little endian/big endian swap code would
@@ -383,7 +492,7 @@ void Machine::OneInstruction(Instruction *instr) {
             ASSERT((tmp & 0x3) == 0);
 
             if (!ReadMem(tmp, 4, &value))
-                return;
+                return FALSE;
 #endif
 
             if (registers[LoadReg] == instr->rt)
@@ -455,12 +564,12 @@ void Machine::OneInstruction(Instruction *instr) {
 
         case OP_SB:
             if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-                return;
+                return FALSE;
             break;
 
         case OP_SH:
             if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-                return;
+                return FALSE;
             break;
 
         case OP_SLL:
@@ -529,7 +638,7 @@ void Machine::OneInstruction(Instruction *instr) {
             if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
                 ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
                 RaiseException(OverflowException, 0);
-                return;
+                return FALSE;
             }
             registers[instr->rd] = diff;
             break;
@@ -540,7 +649,7 @@ void Machine::OneInstruction(Instruction *instr) {
 
         case OP_SW:
             if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-                return;
+                return FALSE;
             break;
 
         case OP_SWL:
@@ -556,7 +665,7 @@ void Machine::OneInstruction(Instruction *instr) {
             byte = tmp & 0x3;
             // DEBUG('P', "Addr 0x%X\n",tmp-byte);
             if (!ReadMem(tmp - byte, 4, &value))
-                return;
+                return FALSE;
 
                 // DEBUG('P', "Value 0x%X\n",value);
 #else
@@ -566,7 +675,7 @@ void Machine::OneInstruction(Instruction *instr) {
             ASSERT((tmp & 0x3) == 0);
 
             if (!ReadMem((tmp & ~0x3), 4, &value))
-                return;
+                return FALSE;
 #endif
 
 #ifdef SIM_FIX
@@ -593,12 +702,12 @@ void Machine::OneInstruction(Instruction *instr) {
             }
 #ifndef SIM_FIX
             if (!WriteMem((tmp & ~0x3), 4, value))
-                return;
+                return FALSE;
 #else
             // DEBUG('P', "Value 0x%X\n",value);
 
             if (!WriteMem((tmp - byte), 4, value))
-                return;
+                return FALSE;
 #endif  // SIM_FIX
             break;
 
@@ -611,7 +720,7 @@ void Machine::OneInstruction(Instruction *instr) {
             ASSERT((tmp & 0x3) == 0);
 
             if (!ReadMem((tmp & ~0x3), 4, &value))
-                return;
+                return FALSE;
 #else
             // The only difference between this code and the BIG ENDIAN code
             // is that the ReadMem call is guaranteed an aligned access as
@@ -624,7 +733,7 @@ void Machine::OneInstruction(Instruction *instr) {
             // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
             if (!ReadMem(tmp - byte, 4, &value))
-                return;
+                return FALSE;
                 // DEBUG('P', "Value 0x%X\n",value);
 #endif  // SIM_FIX
 
@@ -650,12 +759,12 @@ void Machine::OneInstruction(Instruction *instr) {
 
 #ifndef SIM_FIX
             if (!WriteMem((tmp & ~0x3), 4, value))
-                return;
+                return FALSE;
 #else
             // DEBUG('P', "Value 0x%X\n",value);
 
             if (!WriteMem((tmp - byte), 4, value))
-                return;
+                return FALSE;
 #endif  // SIM_FIX
 
             break;
@@ -663,7 +772,7 @@ void Machine::OneInstruction(Instruction *instr) {
         case OP_SYSCALL:
             DEBUG(dbgTraCode, "In Machine::OneInstruction, RaiseException(SyscallException, 0), " << kernel->stats->totalTicks);
             RaiseException(SyscallException, 0);
-            return;
+            return FALSE;
 
         case OP_XOR:
             registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -676,7 +785,7 @@ void Machine::OneInstruction(Instruction *instr) {
         case OP_RES:
         case OP_UNIMP:
             RaiseException(IllegalInstrException, 0);
-            return;
+            return FALSE;
 
         default:
             ASSERT(FALSE);
@@ -692,6 +801,139 @@ void Machine::OneInstruction(Instruction *instr) {
                                               // are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::DecodedAt
+// 	Return the predecoded instruction stored at "physAddr" in main
+//	memory, decoding it first if it is not yet in the cache.
+//
+//	Decoded instructions are cached per word of physical memory, so
+//	the decode work is done only once for each instruction in a code
+//	page, until the page is written or handed to another address
+//	space (see Machine::InvalidateDecodedPage).
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::DecodedAt(int physAddr) {
+    Instruction *cached = &decodeCache[physAddr / 4];
+
+    if (cached->opCode == 0) {  // not decoded since the page was last written
+        cached->value = WordToHost(*(unsigned int *)&mainMemory[physAddr]);
+        cached->Decode();
+        pageDecoded[physAddr / PageSize] = TRUE;
+    }
+    return cached;
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Fetch and decode the instruction at the current PC.
+//
+//	Returns FALSE if the PC could not be translated, after the
+//	exception has been raised.
+//
+//	"instr" -- the place to copy the decoded instruction
+//----------------------------------------------------------------------
+
+bool Machine::FetchInstruction(Instruction *instr) {
+    ExceptionType exception;
+    int physicalAddress;
+
+    if (!CachedTranslate(registers[PCReg], &physicalAddress, 4, FALSE)) {
+        exception = Translate(registers[PCReg], &physicalAddress, 4, FALSE);
+        if (exception != NoException) {
+            RaiseException(exception, registers[PCReg]);
+            return FALSE;
+        }
+    }
+    *instr = *DecodedAt(physicalAddress);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// IsControlTransfer, EndsBlock
+// 	Classify decoded instructions for splitting code into basic
+//	blocks.  A branch or jump ends its block after the delay slot;
+//	a syscall or an illegal instruction always traps, so it ends
+//	its block right away.
+//----------------------------------------------------------------------
+
+static bool
+IsControlTransfer(int opCode) {
+    switch (opCode) {
+        case OP_BEQ:
+        case OP_BGEZ:
+        case OP_BGEZAL:
+        case OP_BGTZ:
+        case OP_BLEZ:
+        case OP_BLTZ:
+        case OP_BLTZAL:
+        case OP_BNE:
+        case OP_J:
+        case OP_JAL:
+        case OP_JALR:
+        case OP_JR:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+static bool
+EndsBlock(int opCode) {
+    return (opCode == OP_SYSCALL) || (opCode == OP_RES) || (opCode == OP_UNIMP);
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchBlock
+// 	Find the basic block starting at the current PC, building it
+//	the first time the PC is seen.
+//
+//	A block is a run of consecutive entries of the predecoded
+//	instruction cache, so it never crosses a page boundary, and it
+//	is thrown away along with the rest of the page's entries.  Its
+//	length is remembered in blockLength, at the block's first word.
+//
+//	Returns NULL if the PC could not be translated, after the
+//	exception has been raised.
+//
+//	"length" -- the place to store the number of instructions
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchBlock(int *length) {
+    ExceptionType exception;
+    int physicalAddress, first, pageEnd, n;
+
+    if (!CachedTranslate(registers[PCReg], &physicalAddress, 4, FALSE)) {
+        exception = Translate(registers[PCReg], &physicalAddress, 4, FALSE);
+        if (exception != NoException) {
+            RaiseException(exception, registers[PCReg]);
+            return NULL;
+        }
+    }
+    first = physicalAddress / 4;
+    if (blockLength[first] == 0) {
+        pageEnd = (physicalAddress / PageSize + 1) * PageSize / 4;
+        for (n = 0; first + n < pageEnd;) {
+            int opCode = DecodedAt((first + n) * 4)->opCode;
+            n++;
+            if (EndsBlock(opCode))
+                break;
+            if (IsControlTransfer(opCode)) {
+                if (first + n < pageEnd) {  // include the delay slot
+                    DecodedAt((first + n) * 4);
+                    n++;
+                }
+                break;
+            }
+        }
+        blockLength[first] = n;
+    }
+    *length = blockLength[first];
+    return &decodeCache[first];
 }
 
 //----------------------------------------------------------------------
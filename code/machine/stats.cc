@@ -22,6 +22,12 @@ Statistics::Statistics() {
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numTLBHits = numTLBMisses = 0;
+    numCacheHits = numCacheMisses = 0;
+    numJournalCommits = 0;
+    for (int i = 0; i < NumLatencyBuckets; i++) {
+        diskLatency[i] = 0;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -35,9 +41,34 @@ void Statistics::Print() {
     cout << ", system " << systemTicks << ", user " << userTicks << "\n";
     cout << "Disk I/O: reads " << numDiskReads;
     cout << ", writes " << numDiskWrites << "\n";
+    if (numDiskReads + numDiskWrites > 0) {
+        cout << "Disk latency:";
+        for (int i = 0; i < NumLatencyBuckets; i++) {
+            if (diskLatency[i] > 0) {
+                if (i < NumLatencyBuckets - 1) {
+                    cout << " <" << (RotationTime << i);
+                } else {
+                    cout << " >=" << (RotationTime << (i - 1));
+                }
+                cout << ": " << diskLatency[i];
+            }
+        }
+        cout << "\n";
+    }
     cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
     cout << "Paging: faults " << numPageFaults << "\n";
+    if (numTLBHits + numTLBMisses > 0) {  // only if there is a TLB
+        cout << "TLB: hits " << numTLBHits;
+        cout << ", misses " << numTLBMisses << "\n";
+    }
+    if (numCacheHits + numCacheMisses > 0) {  // only if files were used
+        cout << "Buffer cache: hits " << numCacheHits;
+        cout << ", misses " << numCacheMisses << "\n";
+    }
+    if (numJournalCommits > 0) {
+        cout << "Journal: commits " << numJournalCommits << "\n";
+    }
     cout << "Network I/O: packets received " << numPacketsRecvd;
     cout << ", sent " << numPacketsSent << "\n";
 }
@@ -19,6 +19,8 @@
 //
 // The fields in this class are public to make it easier to update.
 
+const int NumLatencyBuckets = 12;  // how finely to count disk latencies
+
 class Statistics {
    public:
     int totalTicks;   // Total time running Nachos
@@ -33,6 +35,19 @@ class Statistics {
     int numConsoleCharsRead;     // number of characters read from the keyboard
     int numConsoleCharsWritten;  // number of characters written to the display
     int numPageFaults;           // number of virtual memory page faults
+    int numTLBHits;              // number of translations found in the TLB
+    int numTLBMisses;            // number of translations not in the TLB
+    int numCacheHits;            // number of disk sectors found in the
+                                 // buffer cache
+    int numCacheMisses;          // number that had to be read in
+    int numJournalCommits;       // number of file system transactions
+                                 // committed to the journal
+    int diskLatency[NumLatencyBuckets];
+    // number of disk requests that took (from
+    // being asked for to being done) less than
+    // RotationTime, less than twice that,
+    // four times, ...; the last bucket gets
+    // all the longer ones
     int numPacketsSent;          // number of packets sent over the network
     int numPacketsRecvd;         // number of packets received over the network
 
@@ -88,10 +88,12 @@ bool Machine::ReadMem(int addr, int size, int *value) {
 
     DEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
 
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-        RaiseException(exception, addr);
-        return FALSE;
+    if (!CachedTranslate(addr, &physicalAddress, size, FALSE)) {
+        exception = Translate(addr, &physicalAddress, size, FALSE);
+        if (exception != NoException) {
+            RaiseException(exception, addr);
+            return FALSE;
+        }
     }
     switch (size) {
         case 1:
@@ -136,10 +138,12 @@ bool Machine::WriteMem(int addr, int size, int value) {
 
     DEBUG(dbgAddr, "Writing VA " << addr << ", size " << size << ", value " << value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-        RaiseException(exception, addr);
-        return FALSE;
+    if (!CachedTranslate(addr, &physicalAddress, size, TRUE)) {
+        exception = Translate(addr, &physicalAddress, size, TRUE);
+        if (exception != NoException) {
+            RaiseException(exception, addr);
+            return FALSE;
+        }
     }
     switch (size) {
         case 1:
@@ -157,6 +161,8 @@ bool Machine::WriteMem(int addr, int size, int value) {
         default:
             ASSERT(FALSE);
     }
+    if (pageDecoded[physicalAddress / PageSize])  // self-modifying code
+        InvalidateDecodedPage(physicalAddress / PageSize);
 
     return TRUE;
 }
@@ -170,6 +176,10 @@ bool Machine::WriteMem(int addr, int size, int value) {
 //	address in "physAddr".  If there was an error, returns the type
 //	of the exception.
 //
+//	A successful translation is remembered in the translation cache,
+//	for writing only if this was a write (so the dirty bit has been
+//	set), so that later accesses to the page can skip this routine.
+//
 //	"virtAddr" -- the virtual address to translate
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
@@ -209,17 +219,23 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing) {
         }
         entry = &pageTable[vpn];
     } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-            if (tlb[i].valid && (tlb[i].virtualPage == ((int)vpn))) {
+        int set = (vpn % (tlbSize / tlbWays)) * tlbWays;
+        tlbUseCount++;
+        for (entry = NULL, i = set; i < set + tlbWays; i++)
+            if (tlb[i].valid && (tlb[i].virtualPage == ((int)vpn)) &&
+                tlbASID[i] == currentASID) {
                 entry = &tlb[i];  // FOUND!
+                tlbLastUse[i] = tlbUseCount;
                 break;
             }
         if (entry == NULL) {  // not found
             DEBUG(dbgAddr, "Invalid TLB entry for this virtual page!");
+            kernel->stats->numTLBMisses++;
             return PageFaultException;  // really, this is a TLB fault,
                                         // the page may be in memory,
                                         // but not in the TLB
         }
+        kernel->stats->numTLBHits++;
     }
 
     if (entry->readOnly && writing) {  // trying to write to a read-only page
@@ -230,7 +246,7 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing) {
 
     // if the pageFrame is too big, there is something really wrong!
     // An invalid translation was loaded into the page table or TLB.
-    if (pageFrame >= NumPhysPages) {
+    if (pageFrame >= (unsigned int)NumPhysPages) {
         DEBUG(dbgAddr, "Illegal pageframe " << pageFrame);
         return BusErrorException;
     }
@@ -238,6 +254,17 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing) {
     if (writing)
         entry->dirty = TRUE;
     *physAddr = pageFrame * PageSize + offset;
+
+    if (useXlateCache) {
+        XlateEntry *cached = &xlateCache[vpn % XlateCacheSize];
+        if (cached->readPage != (int)vpn || cached->physPage != (int)pageFrame) {
+            cached->writePage = -1;
+        }
+        cached->readPage = vpn;
+        cached->physPage = pageFrame;
+        if (writing)
+            cached->writePage = vpn;
+    }
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
     DEBUG(dbgAddr, "phys addr = " << *physAddr);
     return NoException;
@@ -0,0 +1,12 @@
+#include "syscall.h"
+
+int main() {
+	int n;
+	for (n=0; n<20; n++) {
+		PrintString("The quick brown fox jumps over the lazy dog.\n");
+	}
+	PrintString("");
+	PrintInt(-2147483647 - 1);
+	return 0;
+	//Halt();
+}
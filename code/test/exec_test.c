@@ -0,0 +1,81 @@
+#include "syscall.h"
+
+/* Run with no arguments (nachos -e exec_test), it runs itself again
+ * with ExecV, forks threads, and prints what each call returns.
+ * Started with arguments, it prints them and exits with their number.
+ */
+
+SpaceId child;
+int shared;
+
+void worker() {
+    shared = 1;
+    ThreadYield();
+    PrintString("worker: Join on another thread's child returns ");
+    PrintInt(Join(child));
+    ThreadExit(7);
+}
+
+void fresh() {
+    int probe[16];
+    int i, dirty = 0;
+
+    for (i = 0; i < 16; i++) {
+        if (probe[i] != 0)
+            dirty = 1;
+        probe[i] = -1;
+    }
+    PrintString(dirty ? "fresh: stack was not cleared\n" : "fresh: stack was cleared\n");
+    ThreadExit(0);
+}
+
+int main(int argc, char *argv[]) {
+    char *args[3];
+    char *many[16];
+    char longArg[100];
+    ThreadId tid;
+    int i;
+
+    if (argc > 0) {
+        for (i = 1; i < argc; i++) {
+            PrintString(argv[i]);
+            PrintString("\n");
+        }
+        Exit(argc);
+    }
+
+    args[0] = "exec_test";
+    args[1] = "one";
+    args[2] = "two";
+    child = ExecV(3, args);
+    PrintString("ExecV returns ");
+    PrintInt(child);
+
+    tid = ThreadFork(worker);
+    PrintString("ThreadJoin returns ");
+    PrintInt(ThreadJoin(tid));
+    PrintString("shared is ");
+    PrintInt(shared);
+
+    PrintString("Join returns ");
+    PrintInt(Join(child));
+    PrintString("Join again returns ");
+    PrintInt(Join(child));
+    PrintString("Join on an unknown ID returns ");
+    PrintInt(Join(-5));
+
+    tid = ThreadFork(fresh);
+    ThreadJoin(tid);
+    tid = ThreadFork(fresh);
+    ThreadJoin(tid);
+
+    for (i = 0; i < 99; i++)
+        longArg[i] = 'x';
+    longArg[99] = '\0';
+    for (i = 0; i < 16; i++)
+        many[i] = longArg;
+    many[0] = "exec_test";
+    PrintString("ExecV with too many arguments returns ");
+    PrintInt(ExecV(16, many));
+    return 0;
+}
@@ -41,6 +41,8 @@ Alarm::Alarm(bool doRandom) {
 //
 //	For now, just provide time-slicing.  Only need to time slice
 //      if we're currently running something (in other words, not idle).
+//	Ready threads that have waited too long are aged here as well;
+//	see Scheduler::Age.
 //----------------------------------------------------------------------
 
 void Alarm::CallBack() {
@@ -48,77 +50,8 @@ void Alarm::CallBack() {
     MachineStatus status = interrupt->getStatus();
     
     if (status != IdleMode) {
-        // aging 
-        #pragma region
-        int aging = 10; int maxWaitTime = 1500;
-        for (int i=0; i<10; i++) {
-            Thread* thread = kernel->getThread(i);
-            if (thread != NULL && thread->getStatus() == READY) {
-                thread->waitTime = kernel->stats->totalTicks - thread->startWaitTime;
-                if (thread->waitTime >= maxWaitTime) {
-                    thread->startWaitTime = kernel->stats->totalTicks;
-                    ASSERT(thread->priority >= 0 && thread->priority <= 149);
-                    // L3
-                    if (thread->priority >= 0 && thread->priority <= 49) {
-                        //std::cout << "-->Thread: " << thread->getID() << ", waitTime: " << thread->waitTime << std::endl;
-                        thread->priority += aging;
-                        //std::cout << "-->prioity: " << thread->priority << std::endl;
-                        DEBUG(dbgZ, "[C] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() 
-                                << "] changes its priority from ["<< thread->priority-aging <<"] to ["<< thread->priority <<"]");
-                        if (thread->priority >= 50 && thread->priority <= 99) {
-                            // L3 -> L2
-                            if (kernel->scheduler->L3->IsInList(thread)) {
-                                kernel->scheduler->L3->Remove(thread);
-                                DEBUG(dbgZ, "[B] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is removed from queue L[3]");
-                                kernel->scheduler->L2->Insert(thread);
-                                DEBUG(dbgZ, "[A] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is inserted into queue L[2]");
-                                
-                                //std::cout << "-->L3->L2" << std::endl;
-                                
-                            } else {
-                                //std::cout << "-->list error" << std::endl;
-                            }  
-                        } 
-                        // nothing happen
-                    }
-                    //L2
-                    if (thread->priority >= 50 && thread->priority <= 99) {
-                        //std::cout << "-->Thread: " << thread->getID() << ", waitTime: " << thread->waitTime << std::endl;
-                        thread->priority += aging;
-                        //std::cout << "-->prioity: " << thread->priority << std::endl;
-                        DEBUG(dbgZ, "[C] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() 
-                                << "] changes its priority from ["<< thread->priority-aging <<"] to ["<< thread->priority <<"]");
-                        if (thread->priority >= 100 && thread->priority <= 149) {
-                            // L2 -> L1
-                            if (kernel->scheduler->L2->IsInList(thread)) {
-                                kernel->scheduler->L2->Remove(thread);
-                                DEBUG(dbgZ, "[B] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is removed from queue L[2]");
-                                kernel->scheduler->L1->Insert(thread);
-                                DEBUG(dbgZ, "[A] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is inserted into queue L[1]");
-                                //std::cout << "-->L2->L1" << std::endl;
-                            } else {
-                                //std::cout << "-->list error" << std::endl;
-                            }  
-                        } 
-                        // nothing happen
-                    }
-                    //L1
-                    if (thread->priority >= 100 && thread->priority <= 149) {
-                        //std::cout << "-->Thread: " << thread->getID() << ", waitTime: " << thread->waitTime << std::endl;
-                        if ( (thread->priority+aging) <= 149 ) {
-                            thread->priority += aging;
-                            //std::cout << "-->prioity: " << thread->priority << std::endl;
-                            DEBUG(dbgZ, "[C] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() 
-                                << "] changes its priority from ["<< thread->priority-aging <<"] to ["<< thread->priority <<"]");
-                        } 
-                        // nothing happen
-                    }
+        kernel->scheduler->Age();
 
-                } 
-            }
-        }
-        #pragma endregion
-       
         // L1: preemptive->YieldOnReturn(), L3: time expired->YieldOnReturn()
         ASSERT(kernel->currentThread->priority >= 0 && kernel->currentThread->priority <= 149);
         if (kernel->currentThread->priority >= 0 && kernel->currentThread->priority <= 49) {
@@ -126,7 +59,7 @@ void Alarm::CallBack() {
             interrupt->YieldOnReturn();
         } else if (kernel->currentThread->priority >= 50 && kernel->currentThread->priority <= 99) {
             // L2
-            if (!kernel->scheduler->L1->IsEmpty()) {
+            if (!kernel->scheduler->IsEmpty(1)) {
                 interrupt->YieldOnReturn();
             }
         } else if (kernel->currentThread->priority >= 100 && kernel->currentThread->priority <= 149) {
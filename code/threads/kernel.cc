@@ -7,10 +7,14 @@
 
 #include "kernel.h"
 
+#include "buffercache.h"
 #include "copyright.h"
 #include "debug.h"
+#include "filehdr.h"
+#include "frameallocator.h"
 #include "libtest.h"
 #include "main.h"
+#include "pager.h"
 #include "post.h"
 #include "string.h"
 #include "synch.h"
@@ -18,6 +22,7 @@
 #include "synchdisk.h"
 #include "synchlist.h"
 #include "sysdep.h"
+#include "textcache.h"
 
 //----------------------------------------------------------------------
 // Kernel::Kernel
@@ -28,6 +33,18 @@
 Kernel::Kernel(int argc, char **argv) {
     randomSlice = FALSE;
     debugUserProg = FALSE;
+    blockExec = FALSE;
+    pageSize = DefaultPageSize;
+    numPhysPages = DefaultNumPhysPages;
+#ifdef USE_TLB
+    tlbEntries = TLBSize;
+#else
+    tlbEntries = 0;
+#endif
+    tlbAssoc = 0;
+    tlbPolicy = TLBReplaceLRU;
+    demandPaging = FALSE;
+    diskPolicy = DiskFCFS;
     execExit = FALSE;
     consoleIn = NULL;   // default is stdin
     consoleOut = NULL;  // default is stdout
@@ -37,6 +54,17 @@ Kernel::Kernel(int argc, char **argv) {
     reliability = 1;  // network reliability, default is 1.0
     hostName = 0;     // machine id, also UNIX socket name
                       // 0 is the default machine id
+    tableSize = InitialTableSize;
+    t = new Thread *[tableSize];
+    nextFreeID = new int[tableSize];
+    exits = new ExitRecord *[tableSize];
+    firstChild = new int[tableSize];
+    freeID = -1;
+    threadNum = 0;
+    execfileSize = InitialTableSize;
+    execfile = new char *[execfileSize];
+    execPriority = new int[execfileSize];
+    execfileNum = 0;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-rs") == 0) {
             ASSERT(i + 1 < argc);
@@ -46,17 +74,52 @@ Kernel::Kernel(int argc, char **argv) {
             i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-b") == 0) {
+            blockExec = TRUE;
+        } else if (strcmp(argv[i], "-vm") == 0) {
+            demandPaging = TRUE;
+        } else if (strcmp(argv[i], "-ps") == 0) {
+            ASSERT(i + 1 < argc);  // next argument is int
+            pageSize = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-pm") == 0) {
+            ASSERT(i + 1 < argc);  // next argument is int
+            numPhysPages = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-tlb") == 0) {
+            ASSERT(i + 1 < argc);  // next argument is int
+            tlbEntries = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-tlbways") == 0) {
+            ASSERT(i + 1 < argc);  // next argument is int
+            tlbAssoc = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-tlbpolicy") == 0) {
+            ASSERT(i + 1 < argc);
+            if (!TLBManager::ParsePolicy(argv[i + 1], &tlbPolicy)) {
+                cout << "Unknown TLB replacement policy " << argv[i + 1] << "\n";
+                Exit(1);
+            }
+            i++;
+        } else if (strcmp(argv[i], "-diskpolicy") == 0) {
+            ASSERT(i + 1 < argc);
+            if (!SynchDisk::ParsePolicy(argv[i + 1], &diskPolicy)) {
+                cout << "Unknown disk scheduling policy " << argv[i + 1] << "\n";
+                Exit(1);
+            }
+            i++;
         } else if (strcmp(argv[i], "-e") == 0) {
-            execfile[++execfileNum] = argv[++i];
-            cout << execfile[execfileNum] << "\n";
+            ASSERT(i + 1 < argc);
+            AddExecFile(argv[++i], 0);
+            cout << argv[i] << "\n";
         } else if (strcmp(argv[i], "-ee") == 0) {
             // Added by @dasbd72
             // To end the program after all the threads are done
             execExit = TRUE;
         } else if (strcmp(argv[i], "-ep") == 0) {
-            execfile[++execfileNum] = argv[++i];
-            int priority = atoi(argv[++i]);
-            execPriority[execfileNum] = priority;
+            ASSERT(i + 2 < argc);
+            AddExecFile(argv[i + 1], atoi(argv[i + 2]));
+            i += 2;
         } else if (strcmp(argv[i], "-ci") == 0) {
             ASSERT(i + 1 < argc);
             consoleIn = argv[i + 1];
@@ -79,7 +142,10 @@ Kernel::Kernel(int argc, char **argv) {
             i++;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
-            cout << "Partial usage: nachos [-s]\n";
+            cout << "Partial usage: nachos [-s] [-b]\n";
+            cout << "Partial usage: nachos [-tlb #] [-tlbways #] [-tlbpolicy lru|clock|random]\n";
+            cout << "Partial usage: nachos [-vm] [-ps pageSize] [-pm numPhysPages]\n";
+            cout << "Partial usage: nachos [-diskpolicy fcfs|sstf|scan|clook]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-nf]\n";
@@ -87,6 +153,17 @@ Kernel::Kernel(int argc, char **argv) {
             cout << "Partial usage: nachos [-n #] [-m #]\n";
         }
     }
+    // instructions are fetched a word at a time, and the pager moves
+    // whole disk sectors
+    if (pageSize <= 0 || pageSize % 4 != 0 ||
+        (demandPaging && pageSize % SectorSize != 0)) {
+        cout << "Bad page size " << pageSize << "\n";
+        Exit(1);
+    }
+    if (numPhysPages <= 0) {
+        cout << "Bad number of physical pages " << numPhysPages << "\n";
+        Exit(1);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -101,26 +178,41 @@ void Kernel::Initialize() {
     // But if it ever tries to give up the CPU, we better have a Thread
     // object to save its state.
 
-    currentThread = new Thread("main", threadNum++);
+    currentThread = new Thread("main", AllocateThreadID());
+    t[currentThread->getID()] = currentThread;
     currentThread->setStatus(RUNNING);
 
     stats = new Statistics();        // collect statistics
     interrupt = new Interrupt;       // start up interrupt handling
     scheduler = new Scheduler();     // initialize the ready queue
     alarm = new Alarm(randomSlice);  // start up time slicing
-    machine = new Machine(debugUserProg);
+    if (tlbEntries > 0 && tlbAssoc == 0) {
+        tlbAssoc = tlbEntries;  // fully associative
+    }
+    machine = new Machine(debugUserProg, blockExec, tlbEntries, tlbAssoc,
+                          pageSize, numPhysPages);
+    if (machine->tlb != NULL) {
+        tlbManager = new TLBManager(tlbPolicy);
+    } else {
+        tlbManager = NULL;
+    }
     synchConsoleIn = new SynchConsoleInput(consoleIn);     // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut);  // output to stdout
-    synchDisk = new SynchDisk();                           //
-    
-                          
-    usedPhysPages[NumPhysPages] = {0};
-    numFreePhysPages = NumPhysPages;
-    
+    synchDisk = new SynchDisk("DISK", diskPolicy);         //
+    bufferCache = new BufferCache(synchDisk, NumCacheBlocks);
+    frames = new FrameAllocator(NumPhysPages);
+    if (demandPaging) {
+        pager = new Pager(diskPolicy);
+    } else {
+        pager = NULL;
+    }
+    textCache = new TextCache();
 
 #ifdef FILESYS_STUB
+    fileHeaders = NULL;
     fileSystem = new FileSystem();
 #else
+    fileHeaders = new FileHeaderTable();
     fileSystem = new FileSystem(formatFlag);
 #endif  // FILESYS_STUB
     //postOfficeIn = new PostOfficeInput(10);
@@ -139,13 +231,25 @@ Kernel::~Kernel() {
     delete interrupt;
     delete scheduler;
     delete alarm;
+    delete tlbManager;
     delete machine;
     delete synchConsoleIn;
     delete synchConsoleOut;
+    delete bufferCache;
     delete synchDisk;
+    delete textCache;
+    delete pager;
+    delete frames;
     delete fileSystem;
+    delete fileHeaders;
     //delete postOfficeIn;
     //delete postOfficeOut;
+    delete[] t;
+    delete[] nextFreeID;
+    delete[] exits;
+    delete[] firstChild;
+    delete[] execfile;
+    delete[] execPriority;
 
     Exit(0);
 }
@@ -254,6 +358,137 @@ void Kernel::NetworkTest() {
     // Then we're done!
 }
 
+//----------------------------------------------------------------------
+// Kernel::AllocateThreadID
+// 	Find a free slot in the process table, and return its index,
+//	which becomes the ID of the thread put there.  Freed IDs are
+//	reused first; otherwise the next unused one is handed out,
+//	doubling the table if it is full.
+//----------------------------------------------------------------------
+
+int Kernel::AllocateThreadID() {
+    int id;
+
+    if (freeID >= 0) {
+        id = freeID;
+        freeID = nextFreeID[id];
+    } else {
+        if (threadNum == tableSize) {
+            Thread **biggerTable = new Thread *[tableSize * 2];
+            int *biggerFree = new int[tableSize * 2];
+            ExitRecord **biggerExits = new ExitRecord *[tableSize * 2];
+            int *biggerChild = new int[tableSize * 2];
+            for (int i = 0; i < tableSize; i++) {
+                biggerTable[i] = t[i];
+                biggerFree[i] = nextFreeID[i];
+                biggerExits[i] = exits[i];
+                biggerChild[i] = firstChild[i];
+            }
+            delete[] t;
+            delete[] nextFreeID;
+            delete[] exits;
+            delete[] firstChild;
+            t = biggerTable;
+            nextFreeID = biggerFree;
+            exits = biggerExits;
+            firstChild = biggerChild;
+            tableSize *= 2;
+        }
+        id = threadNum++;
+    }
+    t[id] = NULL;
+    exits[id] = NULL;
+    firstChild[id] = -1;
+    return id;
+}
+
+//----------------------------------------------------------------------
+// Kernel::FreeThreadID
+// 	Put an ID back on the free list, along with what was kept about
+//	how its program exited (taking it off its parent's list).
+//----------------------------------------------------------------------
+
+void Kernel::FreeThreadID(int id) {
+    ExitRecord *record = exits[id];
+
+    if (record != NULL) {
+        if (record->parent >= 0) {
+            if (record->prevSibling >= 0) {
+                exits[record->prevSibling]->nextSibling = record->nextSibling;
+            } else {
+                firstChild[record->parent] = record->nextSibling;
+            }
+            if (record->nextSibling >= 0) {
+                exits[record->nextSibling]->prevSibling = record->prevSibling;
+            }
+        }
+        delete record->done;
+        delete record;
+        exits[id] = NULL;
+    }
+    nextFreeID[id] = freeID;
+    freeID = id;
+}
+
+//----------------------------------------------------------------------
+// Kernel::RemoveThread
+// 	Take a thread out of the process table, when it is being
+//	deleted, so that its ID can be given to a later thread.
+//	Threads that were never put in the table are ignored.
+//----------------------------------------------------------------------
+
+void Kernel::RemoveThread(Thread *thread) {
+    int id = thread->getID();
+    int child, next;
+
+    if (getThread(id) != thread) {
+        return;
+    }
+    t[id] = NULL;
+
+    // nobody is left to Join the programs this thread started
+    for (child = firstChild[id]; child >= 0; child = next) {
+        next = exits[child]->nextSibling;
+        exits[child]->parent = -1;
+        if (t[child] == NULL) {
+            FreeThreadID(child);  // already gone
+        }
+    }
+    firstChild[id] = -1;
+
+    // if the parent can still Join us, our ID is kept until it does
+    if (exits[id] != NULL && exits[id]->parent >= 0) {
+        exits[id]->done->V();
+    } else {
+        FreeThreadID(id);
+    }
+}
+
+//----------------------------------------------------------------------
+// Kernel::AddExecFile
+// 	Remember a user program to be run by ExecAll, growing the
+//	list if it is full.
+//----------------------------------------------------------------------
+
+void Kernel::AddExecFile(char *name, int priority) {
+    if (execfileNum == execfileSize) {
+        char **biggerFiles = new char *[execfileSize * 2];
+        int *biggerPriority = new int[execfileSize * 2];
+        for (int i = 0; i < execfileSize; i++) {
+            biggerFiles[i] = execfile[i];
+            biggerPriority[i] = execPriority[i];
+        }
+        delete[] execfile;
+        delete[] execPriority;
+        execfile = biggerFiles;
+        execPriority = biggerPriority;
+        execfileSize *= 2;
+    }
+    execfile[execfileNum] = name;
+    execPriority[execfileNum] = priority;
+    execfileNum++;
+}
+
 void ForkExecute(Thread *t) {
     
     if (!t->space->Load(t->getName())) {
@@ -264,7 +499,7 @@ void ForkExecute(Thread *t) {
 }
 
 void Kernel::ExecAll() {
-    for (int i = 1; i <= execfileNum; i++) {
+    for (int i = 0; i < execfileNum; i++) {
         int a = Exec(execfile[i], execPriority[i]);
     }
     //cout << "\n\nexecAll\n\n";
@@ -272,14 +507,170 @@ void Kernel::ExecAll() {
     // Kernel::Exec();
 }
 
+//----------------------------------------------------------------------
+// Kernel::CreateProgram
+// 	Put a new thread in the process table, with an empty address
+//	space, to run a user program once it is forked.
+//----------------------------------------------------------------------
+
+Thread *Kernel::CreateProgram(char *name, int priority) {
+    int id = AllocateThreadID();
+
+    t[id] = new Thread(name, id, priority);
+    t[id]->setIsExec();
+    t[id]->space = new AddrSpace(frames);
+    return t[id];
+}
+
+//----------------------------------------------------------------------
+// Kernel::ExecV
+// 	Start running a user program on behalf of the current thread,
+//	which can wait for it to finish with Join.  Returns the new
+//	program's ID.
+//
+//	"argc", "argv" -- the program's arguments, the first being the
+//		name of the executable; allocated with new[], and deleted
+//		along with the program's address space
+//	"priority" -- the new thread's scheduling priority
+//----------------------------------------------------------------------
+
+int Kernel::ExecV(int argc, char **argv, int priority) {
+    Thread *thread = CreateProgram(argv[0], priority);
+    int id = thread->getID();
+
+    AddExitRecord(id);
+    thread->space->SetArguments(argc, argv);
+    thread->Fork((VoidFunctionPtr)&ForkExecute, (void *)thread);
+    return id;
+}
+
+//----------------------------------------------------------------------
+// Kernel::AddExitRecord
+// 	Note that the current thread has started a program or a thread,
+//	and can Join it: give it an ExitRecord, and put it on the current
+//	thread's list.
+//
+//	"id" -- the new program or thread
+//----------------------------------------------------------------------
+
+void Kernel::AddExitRecord(int id) {
+    ExitRecord *record = new ExitRecord;
+
+    record->done = new Semaphore("exit", 0);
+    record->status = -1;
+    record->parent = currentThread->getID();
+    record->prevSibling = -1;
+    record->nextSibling = firstChild[record->parent];
+    if (record->nextSibling >= 0) {
+        exits[record->nextSibling]->prevSibling = id;
+    }
+    firstChild[record->parent] = id;
+    exits[id] = record;
+}
+
+//----------------------------------------------------------------------
+// ForkThread
+// 	Start running a thread forked by a user program: its user
+//	registers have been set up to call the function on a stack of
+//	its own.
+//----------------------------------------------------------------------
+
+static void
+ForkThread(Thread *t) {
+    t->RestoreUserState();
+    t->space->RestoreState();
+    kernel->machine->Run();  // never returns; the thread exits
+                             // by the syscall "ThreadExit"
+    ASSERTNOTREACHED();
+}
+
+//----------------------------------------------------------------------
+// Kernel::ThreadFork
+// 	Start a new thread running a function of the current thread's
+//	user program, in the same address space but on a stack of its
+//	own.  The current thread can wait for it with Join.  Returns
+//	the new thread's ID, or -1 if the address space has no room for
+//	another stack.
+//
+//	The function must end by calling ThreadExit: it has nowhere to
+//	return to.
+//
+//	"func" -- the address of the function, in the user program
+//	"priority" -- the new thread's scheduling priority
+//----------------------------------------------------------------------
+
+int Kernel::ThreadFork(int func, int priority) {
+    AddrSpace *space = currentThread->space;
+    int id = AllocateThreadID();
+    int stackTop = space->AddStack(id);
+    Thread *thread;
+
+    if (stackTop < 0) {
+        FreeThreadID(id);
+        return -1;
+    }
+    thread = new Thread(currentThread->getName(), id, priority);
+    thread->setIsExec();
+    thread->space = space;
+    t[id] = thread;
+    AddExitRecord(id);
+
+    // the registers it starts with: all zero, except that it runs
+    // "func" on its own stack (see AddrSpace::InitRegisters)
+    for (int i = 0; i < NumTotalRegs; i++) {
+        thread->SetUserRegister(i, 0);
+    }
+    thread->SetUserRegister(PCReg, func);
+    thread->SetUserRegister(NextPCReg, func + 4);
+    thread->SetUserRegister(StackReg, stackTop - 16);
+
+    thread->Fork((VoidFunctionPtr)&ForkThread, (void *)thread);
+    return id;
+}
+
+//----------------------------------------------------------------------
+// Kernel::Join
+// 	Wait for a user program started by the current thread to finish,
+//	and return the status it passed to Exit.  Afterwards its ID may
+//	be reused.  Returns -1 if "id" is not such a program (or has
+//	been joined already).
+//----------------------------------------------------------------------
+
+int Kernel::Join(int id) {
+    ExitRecord *record = (id >= 0 && id < threadNum) ? exits[id] : NULL;
+    int status;
+
+    if (record == NULL || record->parent != currentThread->getID()) {
+        return -1;
+    }
+    record->done->P();
+    status = record->status;
+    FreeThreadID(id);
+    return status;
+}
+
+//----------------------------------------------------------------------
+// Kernel::ExitProgram
+// 	Finish the current thread, because its user program is done
+//	(Exit) or the thread is (ThreadExit), recording "status" for a
+//	parent waiting in Join.  Other threads running in the same
+//	address space keep running.
+//----------------------------------------------------------------------
+
+void Kernel::ExitProgram(int status) {
+    ExitRecord *record = exits[currentThread->getID()];
+
+    if (record != NULL) {
+        record->status = status;
+    }
+    currentThread->Finish();
+}
+
 int Kernel::Exec(char *name, int priority) {
-    t[threadNum] = new Thread(name, threadNum, priority);
-    t[threadNum]->setIsExec();
-    t[threadNum]->space = new AddrSpace(usedPhysPages, &numFreePhysPages);
-    t[threadNum]->Fork((VoidFunctionPtr)&ForkExecute, (void *)t[threadNum]);
-    threadNum++;
+    Thread *thread = CreateProgram(name, priority);
 
-    return threadNum - 1;
+    thread->Fork((VoidFunctionPtr)&ForkExecute, (void *)thread);
+    return thread->getID();
     /*
         cout << "Total threads number is " << execfileNum << endl;
         for (int n=1;n<=execfileNum;n++) {
@@ -16,17 +16,42 @@
 #include "machine.h"
 #include "scheduler.h"
 #include "stats.h"
+#include "synchdisk.h"
 #include "thread.h"
+#include "tlbmanager.h"
 #include "utility.h"
 
+class BufferCache;
+class FileHeaderTable;
+class FrameAllocator;
+class Pager;
 class PostOfficeInput;
 class PostOfficeOutput;
+class Semaphore;
 class SynchConsoleInput;
 class SynchConsoleOutput;
-class SynchDisk;
+class TextCache;
 
 typedef int OpenFileId;
 
+const int InitialTableSize = 16;  // process table slots to start with;
+                                  // the table doubles when it fills up
+
+// How a user program started by another one (with the Exec system
+// call) ended.  Kept in the process table, along with the program's
+// ID, until the parent Joins it.  The programs a thread has started
+// are on a list, so that they can be told when it goes away.
+
+class ExitRecord {
+   public:
+    Semaphore *done;  // signalled when the program is gone
+    int status;       // what it passed to Exit, -1 if it never did
+    int parent;       // ID of the thread that may Join it,
+                      // or -1 if that thread is gone
+    int prevSibling;  // the parent's other programs, linked
+    int nextSibling;  // by ID; -1 ends the list
+};
+
 class Kernel {
    public:
     Kernel(int argc, char **argv);
@@ -38,11 +63,26 @@ class Kernel {
                         // refers to "kernel" as a global
     void ExecAll();
     int Exec(char *name, int priority);
+    int ExecV(int argc, char **argv, int priority);
+    // run a user program for the current
+    // thread, which can Join it
+    int ThreadFork(int func, int priority);
+    // run a function of the current user
+    // program in a new thread, which the
+    // current thread can Join
+    int Join(int id);               // wait for it to exit
+    void ExitProgram(int status);   // the current program is done
     void ThreadSelfTest();  // self test of threads and synchronization
 
     void ConsoleTest();  // interactive console self test
     void NetworkTest();  // interactive 2-machine network test
-    Thread *getThread(int threadID) { return t[threadID]; }
+    Thread *getThread(int threadID) {
+        return (threadID >= 0 && threadID < threadNum) ? t[threadID] : NULL;
+    }
+    // the thread with an ID, or NULL
+    int NumThreadIDs() { return threadNum; }
+    // every thread ID in use is below this
+    void RemoveThread(Thread *thread);  // free a thread's ID for reuse
 
     void PrintInt(int number);
     int CreateFile(char *filename);  // fileSystem call
@@ -63,9 +103,17 @@ class Kernel {
     Statistics *stats;      // performance metrics
     Alarm *alarm;           // the software alarm clock
     Machine *machine;       // the simulated CPU
+    TLBManager *tlbManager; // TLB miss handler, NULL if no TLB
+    FrameAllocator *frames; // which physical pages are in use
+    Pager *pager;           // page fault handler, NULL if user
+                            // programs are not demand paged
+    TextCache *textCache;   // code shared by user programs
     SynchConsoleInput *synchConsoleIn;
     SynchConsoleOutput *synchConsoleOut;
     SynchDisk *synchDisk;
+    BufferCache *bufferCache; // recently used sectors of synchDisk
+    FileHeaderTable *fileHeaders; // headers of open files, NULL
+                                  // with the stub file system
     FileSystem *fileSystem;
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
@@ -74,20 +122,40 @@ class Kernel {
 
     int hostName;  // machine identifier
 
-    int usedPhysPages[NumPhysPages];
-    unsigned int numFreePhysPages;
-
    private:
-    Thread *t[10];
-    char *execfile[10];
+    int AllocateThreadID();                 // find a free slot
+    void FreeThreadID(int id);              // and give it back
+    Thread *CreateProgram(char *name, int priority);
+    // a thread to run a user program
+    void AddExitRecord(int id);  // let the current thread Join it
+    void AddExecFile(char *name, int priority);  // remember a -e/-ep
+
+    Thread **t;        // process table, indexed by thread ID
+    int *nextFreeID;   // free IDs, linked through the table
+    ExitRecord **exits;  // how each program ended, NULL if
+                         // no one can Join it
+    int *firstChild;     // the first program each thread started
+                         // that it can still Join, or -1
+    int freeID;        // first free ID, or -1
+    int tableSize;     // number of slots in the table
+    int threadNum;     // IDs below this have been handed out
+    char **execfile;   // user programs to run, in order
+    int *execPriority; // and their initial priorities
     int execfileNum;
-    int threadNum;
+    int execfileSize;
     bool randomSlice;    // enable pseudo-random time slicing
     bool debugUserProg;  // single step user program
+    bool blockExec;      // run user code a basic block at a time
+    int pageSize;        // bytes in a page of physical memory
+    int numPhysPages;    // and how many pages there are
+    int tlbEntries;      // size of the TLB, 0 for a page table
+    int tlbAssoc;        // entries per TLB set, 0 for fully associative
+    TLBPolicy tlbPolicy; // which TLB entry to replace on a miss
+    bool demandPaging;   // load user program pages on demand
+    DiskPolicy diskPolicy;  // which waiting disk request goes next
     double reliability;  // likelihood messages are dropped
     char *consoleIn;     // file to read console input from
     char *consoleOut;    // file to send console output to
-    int execPriority[10];
 #ifndef FILESYS_STUB
     bool formatFlag;  // format the disk if this is true
 #endif
@@ -3,16 +3,26 @@
 //	operating system kernel.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
+//              -s -b -x <nachos file> -ci <consoleIn> -co <consoleOut>
+//              -tlb <# entries> -tlbways <# ways> -tlbpolicy <policy> -vm
+//              -ps <page size> -pm <# physical pages>
 //              -f -cp <unix file> <nachos file>
-//              -p <nachos file> -r <nachos file> -l -D
+//              -p <nachos file> -r <nachos file> -md <nachos dir> -l -D
 //              -n <network reliability> -m <machine id>
-//              -z -K -C -N
+//              -z -K -C -N -B
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -b runs user programs a basic block at a time (faster, same timing)
+//    -tlb translates user addresses through a TLB of this many entries
+//    -tlbways sets the TLB associativity (default: fully associative)
+//    -tlbpolicy picks the TLB entry to replace: lru (default), clock, random
+//    -vm loads user program pages on demand, paging to the SWAP_<id> disk
+//    -ps sets the page size in bytes (default 128; with -vm, a multiple
+//	of the disk sector size)
+//    -pm sets the number of pages of physical memory (default 128)
 //    -x runs a user program
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
@@ -21,13 +31,15 @@
 //    -K run a simple self test of kernel threads and synchronization
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
+//    -B run micro-benchmarks of kernel data structures
 //
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
-//    -l lists the contents of the Nachos directory
+//    -r removes a Nachos file, or an empty directory, from the file system
+//    -md makes a Nachos directory
+//    -l lists the files in the Nachos directories
 //    -D prints the contents of the entire file system
 //
 //  Note: the file system flags are not used if the stub filesystem
@@ -42,6 +54,7 @@
 #undef MAIN
 
 #include "filesys.h"
+#include "libtest.h"
 #include "main.h"
 #include "openfile.h"
 #include "sysdep.h"
@@ -162,11 +175,13 @@ int main(int argc, char **argv) {
     bool threadTestFlag = false;
     bool consoleTestFlag = false;
     bool networkTestFlag = false;
+    bool benchmarkFlag = false;
 #ifndef FILESYS_STUB
     char *copyUnixFileName = NULL;    // UNIX file to be copied into Nachos
     char *copyNachosFileName = NULL;  // name of copied file in Nachos
     char *printFileName = NULL;
     char *removeFileName = NULL;
+    char *makeDirName = NULL;
     bool dirListFlag = false;
     bool dumpFlag = false;
 #endif  // FILESYS_STUB
@@ -191,6 +206,8 @@ int main(int argc, char **argv) {
             consoleTestFlag = TRUE;
         } else if (strcmp(argv[i], "-N") == 0) {
             networkTestFlag = TRUE;
+        } else if (strcmp(argv[i], "-B") == 0) {
+            benchmarkFlag = TRUE;
         }
 #ifndef FILESYS_STUB
         else if (strcmp(argv[i], "-cp") == 0) {
@@ -206,6 +223,10 @@ int main(int argc, char **argv) {
             ASSERT(i + 1 < argc);
             removeFileName = argv[i + 1];
             i++;
+        } else if (strcmp(argv[i], "-md") == 0) {
+            ASSERT(i + 1 < argc);
+            makeDirName = argv[i + 1];
+            i++;
         } else if (strcmp(argv[i], "-l") == 0) {
             dirListFlag = true;
         } else if (strcmp(argv[i], "-D") == 0) {
@@ -215,10 +236,11 @@ int main(int argc, char **argv) {
         else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-z -d debugFlags]\n";
             cout << "Partial usage: nachos [-x programName]\n";
-            cout << "Partial usage: nachos [-K] [-C] [-N]\n";
+            cout << "Partial usage: nachos [-K] [-C] [-N] [-B]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
+            cout << "Partial usage: nachos [-md dirName]\n";
             cout << "Partial usage: nachos [-l] [-D]\n";
 #endif  // FILESYS_STUB
         }
@@ -244,8 +266,16 @@ int main(int argc, char **argv) {
     if (networkTestFlag) {
         kernel->NetworkTest();  // two-machine test of the network
     }
+    if (benchmarkFlag) {
+        LibBenchmark();  // time library data structures
+    }
 
 #ifndef FILESYS_STUB
+    if (makeDirName != NULL) {
+        if (!kernel->fileSystem->CreateDirectory(makeDirName)) {
+            printf("Couldn't make directory %s\n", makeDirName);
+        }
+    }
     if (removeFileName != NULL) {
         kernel->fileSystem->Remove(removeFileName);
     }
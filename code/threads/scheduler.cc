@@ -25,49 +25,84 @@
 #include "main.h"
 
 //----------------------------------------------------------------------
-// Scheduler::Scheduler
-// 	Initialize the list of ready but not running threads.
-//	Initially, no ready threads.
+// L1Compare, L2Compare
+//	Order the threads in an L1 heap (shortest remaining burst time
+//	first) or in an L2 bucket (all the same priority, so lowest ID
+//	first).  Ties are broken by thread ID.
 //----------------------------------------------------------------------
 
-
 static int
-L2Compare(Thread *x, Thread *y) {
-    if (x->priority > y->priority) {
+L1Compare(Thread *x, Thread *y) {
+    if (x->remainingBurstTime < y->remainingBurstTime) {
         return -1;
-    } else if (x->priority < y->priority) {
+    } else if (x->remainingBurstTime > y->remainingBurstTime) {
         return 1;
-    } else {
-        // priority一樣，比ID
-        if (x->getID() < y->getID()) {
-            return -1;
-        } 
+    } else if (x->getID() < y->getID()) {
+        return -1;
+    } else if (x->getID() > y->getID()) {
         return 1;
     }
+    return 0;
 }
 
 static int
-L1Compare(Thread *x, Thread *y) {
-    if (x->remainingBurstTime < y->remainingBurstTime) {
+L2Compare(Thread *x, Thread *y) {
+    if (x->getID() < y->getID()) {
         return -1;
-    } else if (x->remainingBurstTime > y->remainingBurstTime) {
+    } else if (x->getID() > y->getID()) {
         return 1;
-    } else {
-        // priority一樣，比ID
-        if (x->getID() < y->getID()) {
-            return -1;
-        } 
+    }
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// AgingCompare
+//	Order the threads waiting to be aged by when they started
+//	waiting, and so by when they are next due for a promotion.
+//----------------------------------------------------------------------
+
+static int
+AgingCompare(Thread *x, Thread *y) {
+    if (x->startWaitTime < y->startWaitTime) {
+        return -1;
+    } else if (x->startWaitTime > y->startWaitTime) {
         return 1;
     }
+    return L2Compare(x, y);
 }
 
+//----------------------------------------------------------------------
+// ReadyPosition, AgingPosition
+//	Tell the heaps where a thread keeps its position, so that it
+//	can be taken out of the middle of a heap.
+//----------------------------------------------------------------------
+
+static int *
+ReadyPosition(Thread *thread) {
+    return &thread->readyIndex;
+}
+
+static int *
+AgingPosition(Thread *thread) {
+    return &thread->agingIndex;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Scheduler
+// 	Initialize the list of ready but not running threads.
+//	Initially, no ready threads.
+//----------------------------------------------------------------------
 
 Scheduler::Scheduler() {
-    L3 = new List<Thread *>;
-    L2 = new SortedList<Thread *>(L2Compare);
-    L1 = new SortedList<Thread *>(L1Compare);
-    
-    
+    L1 = new Heap<Thread *>(L1Compare, ReadyPosition);
+    for (int i = 0; i < NumL2Priorities; i++) {
+        L2[i] = new Heap<Thread *>(L2Compare, ReadyPosition);
+    }
+    L2Busy = new Bitmap(NumL2Priorities);
+    L3Head = L3Tail = NULL;
+    aging = new Heap<Thread *>(AgingCompare, AgingPosition);
+    due = new Heap<Thread *>(L2Compare, NULL);
+
     toBeDestroyed = NULL;
 }
 
@@ -77,10 +112,158 @@ Scheduler::Scheduler() {
 //----------------------------------------------------------------------
 
 Scheduler::~Scheduler() {
-    delete L3;
-    delete L2;
     delete L1;
-    
+    for (int i = 0; i < NumL2Priorities; i++) {
+        delete L2[i];
+    }
+    delete L2Busy;
+    delete aging;
+    delete due;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::LevelOf
+// 	Return the ready queue (1, 2 or 3) for threads of a priority.
+//----------------------------------------------------------------------
+
+int Scheduler::LevelOf(int priority) {
+    ASSERT(priority >= MinPriority && priority <= MaxPriority);
+    if (priority >= MinL1Priority) {
+        return 1;
+    } else if (priority >= MinL2Priority) {
+        return 2;
+    }
+    return 3;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Enqueue
+// 	Put a thread on the ready queue for its priority.
+//----------------------------------------------------------------------
+
+void Scheduler::Enqueue(Thread *thread) {
+    int bucket;
+
+    ASSERT(thread->readyLevel == 0);
+    thread->readyLevel = LevelOf(thread->priority);
+    switch (thread->readyLevel) {
+        case 1:
+            L1->Insert(thread);
+            break;
+        case 2:
+            bucket = MinL1Priority - 1 - thread->priority;
+            L2[bucket]->Insert(thread);
+            L2Busy->Mark(bucket);
+            break;
+        case 3:
+            thread->readyNext = NULL;
+            thread->readyPrev = L3Tail;
+            if (L3Tail == NULL) {
+                L3Head = thread;
+            } else {
+                L3Tail->readyNext = thread;
+            }
+            L3Tail = thread;
+            break;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Dequeue
+// 	Take a thread off whichever ready queue it is on.
+//----------------------------------------------------------------------
+
+void Scheduler::Dequeue(Thread *thread) {
+    int bucket;
+
+    switch (thread->readyLevel) {
+        case 1:
+            L1->Remove(thread);
+            break;
+        case 2:
+            bucket = MinL1Priority - 1 - thread->priority;
+            L2[bucket]->Remove(thread);
+            if (L2[bucket]->IsEmpty()) {
+                L2Busy->Clear(bucket);
+            }
+            break;
+        case 3:
+            if (thread->readyPrev == NULL) {
+                L3Head = thread->readyNext;
+            } else {
+                thread->readyPrev->readyNext = thread->readyNext;
+            }
+            if (thread->readyNext == NULL) {
+                L3Tail = thread->readyPrev;
+            } else {
+                thread->readyNext->readyPrev = thread->readyPrev;
+            }
+            break;
+        default:
+            ASSERTNOTREACHED();
+    }
+    thread->readyLevel = 0;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Age
+// 	Raise the priority of every ready user program thread that has
+//	been waiting for MaxWaitTime ticks, and restart its wait.
+//
+//	Only the front of the aging heap is looked at, so the cost is
+//	proportional to the number of promotions, not to the number of
+//	ready threads.  Threads that come due together are promoted in
+//	thread ID order.
+//
+//	A thread aged from L3 into L2 is aged again as an L2 thread,
+//	and likewise from L2 into L1, so it can gain two steps at once.
+//----------------------------------------------------------------------
+
+void Scheduler::Age() {
+    int now = kernel->stats->totalTicks;
+    Thread *thread;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    while (!aging->IsEmpty() &&
+           now - aging->Front()->startWaitTime >= MaxWaitTime) {
+        due->Insert(aging->RemoveFront());
+    }
+
+    while (!due->IsEmpty()) {
+        thread = due->RemoveFront();
+        thread->waitTime = now - thread->startWaitTime;
+        thread->startWaitTime = now;
+        if (LevelOf(thread->priority) == 3) {
+            SetPriority(thread, thread->priority + AgingStep);
+        }
+        if (LevelOf(thread->priority) == 2) {
+            SetPriority(thread, thread->priority + AgingStep);
+        }
+        if (LevelOf(thread->priority) == 1 &&
+            thread->priority + AgingStep <= MaxPriority) {
+            SetPriority(thread, thread->priority + AgingStep);
+        }
+        aging->Insert(thread);
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::IsEmpty
+// 	Return TRUE if there are no threads on ready queue L[level].
+//----------------------------------------------------------------------
+
+bool Scheduler::IsEmpty(int level) {
+    switch (level) {
+        case 1:
+            return L1->IsEmpty();
+        case 2:
+            return L2Busy->FindFirstSet() < 0;
+        case 3:
+            return L3Head == NULL;
+        default:
+            ASSERTNOTREACHED();
+    }
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -97,19 +280,11 @@ void Scheduler::ReadyToRun(Thread *thread) {
     thread->setStatus(READY);
 
     thread->startWaitTime = kernel->stats->totalTicks;
-    ASSERT(thread->priority >= 0 && thread->priority <= 149);
-    if (thread->priority >= 0 && thread->priority <= 49 ) {
-        DEBUG(dbgZ, "[A] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is inserted into queue L[3]");
-        L3->Append(thread);
+    Enqueue(thread);
+    if (thread->getIsExec()) {
+        aging->Insert(thread);
     }
-    else if (thread->priority >= 50 && thread->priority <= 99 ) {
-        DEBUG(dbgZ, "[A] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is inserted into queue L[2]");
-        L2->Insert(thread);
-    }
-    else if (thread->priority >= 100 && thread->priority <= 149 ) {
-        DEBUG(dbgZ, "[A] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is inserted into queue L[1]");
-        L1->Insert(thread);
-    } 
+    DEBUG(dbgZ, "[A] Tick [" << kernel->stats->totalTicks << "]: Thread [" << thread->getID() << "] is inserted into queue L[" << thread->readyLevel << "]");
 }
 
 //----------------------------------------------------------------------
@@ -122,25 +297,60 @@ void Scheduler::ReadyToRun(Thread *thread) {
 
 Thread *
 Scheduler::FindNextToRun() {
+    Thread *thread;
+    int level, bucket;
+
     ASSERT(kernel->interrupt->getLevel() == IntOff);
     if (!L1->IsEmpty()) {
-        Thread* thread = L1->RemoveFront();
-        DEBUG(dbgZ, "[B] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is removed from queue L[1]");
-        return thread;
-    }
-    else if (!L2->IsEmpty()) {
-        Thread* thread = L2->RemoveFront();
-        DEBUG(dbgZ, "[B] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is removed from queue L[2]");
-        return thread;
-    } else if (!L3->IsEmpty()) {
-        Thread* thread = L3->RemoveFront();
-        DEBUG(dbgZ, "[B] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" << thread->getID() << "] is removed from queue L[3]");
-        return thread;
+        thread = L1->Front();
+    } else if ((bucket = L2Busy->FindFirstSet()) >= 0) {
+        thread = L2[bucket]->Front();
+    } else if (L3Head != NULL) {
+        thread = L3Head;
     } else {
         return NULL;
     }
+    level = thread->readyLevel;
+    Dequeue(thread);
+    if (thread->getIsExec()) {
+        aging->Remove(thread);
+    }
+    DEBUG(dbgZ, "[B] Tick [" << kernel->stats->totalTicks << "]: Thread [" << thread->getID() << "] is removed from queue L[" << level << "]");
+    return thread;
 }
 
+//----------------------------------------------------------------------
+// Scheduler::SetPriority
+// 	Change the priority of a thread.  If the thread is ready to run,
+//	it is moved to the queue (or L2 bucket) for its new priority.
+//
+//	A thread that stays in L1 or L3 keeps its place: L1 is ordered by
+//	burst time, not priority, and L3 is round robin.
+//
+//	"thread" is the thread whose priority changes
+//	"priority" is its new priority
+//----------------------------------------------------------------------
+
+void Scheduler::SetPriority(Thread *thread, int priority) {
+    int oldPriority = thread->priority;
+    int oldLevel = thread->readyLevel;
+    bool move = oldLevel != 0 && (oldLevel == 2 || LevelOf(priority) != oldLevel);
+
+    ASSERT(priority >= MinPriority && priority <= MaxPriority);
+    if (move) {
+        Dequeue(thread);
+    }
+    thread->priority = priority;
+    DEBUG(dbgZ, "[C] Tick [" << kernel->stats->totalTicks << "]: Thread [" << thread->getID()
+                             << "] changes its priority from [" << oldPriority << "] to [" << priority << "]");
+    if (move) {
+        Enqueue(thread);
+        if (thread->readyLevel != oldLevel) {
+            DEBUG(dbgZ, "[B] Tick [" << kernel->stats->totalTicks << "]: Thread [" << thread->getID() << "] is removed from queue L[" << oldLevel << "]");
+            DEBUG(dbgZ, "[A] Tick [" << kernel->stats->totalTicks << "]: Thread [" << thread->getID() << "] is inserted into queue L[" << thread->readyLevel << "]");
+        }
+    }
+}
 
 //----------------------------------------------------------------------
 // Scheduler::Run
@@ -242,5 +452,11 @@ void Scheduler::CheckToBeDestroyed() {
 //----------------------------------------------------------------------
 void Scheduler::Print() {
     cout << "Ready list contents:\n";
-    L3->Apply(ThreadPrint);
+    L1->Apply(ThreadPrint);
+    for (int i = 0; i < NumL2Priorities; i++) {
+        L2[i]->Apply(ThreadPrint);
+    }
+    for (Thread *thread = L3Head; thread != NULL; thread = thread->readyNext) {
+        ThreadPrint(thread);
+    }
 }
@@ -9,13 +9,46 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
+#include "bitmap.h"
 #include "copyright.h"
-#include "list.h"
+#include "heap.h"
 #include "thread.h"
 
+// Thread priorities run from 0 to 149, and split the ready threads
+// into three levels:
+//	L1 (100-149): preemptive shortest-job-first, ordered by the
+//		remaining burst time
+//	L2 (50-99): non-preemptive, ordered by priority
+//	L3 (0-49): round-robin, first come first served
+//
+// Ties are broken in favor of the lower thread ID.
+
+const int MinPriority = 0;
+const int MaxPriority = 149;
+const int MinL2Priority = 50;
+const int MinL1Priority = 100;
+const int NumL2Priorities = MinL1Priority - MinL2Priority;
+
+// A user program thread that has been ready for MaxWaitTime ticks
+// has its priority raised by AgingStep.
+const int AgingStep = 10;
+const int MaxWaitTime = 1500;
+
 // The following class defines the scheduler/dispatcher abstraction --
 // the data structures and operations needed to keep track of which
 // thread is running, and which threads are ready but not running.
+//
+// Every ready-queue operation is O(1) or O(log n):
+//	L1 is a heap keyed on the remaining burst time.
+//	L2 has a bucket per priority (each a heap keyed on the thread ID),
+//	    and a bitmap of which buckets are non-empty, so the highest
+//	    priority is found with a find-first-set.
+//	L3 is a doubly linked FIFO threaded through the threads
+//	    themselves, so a thread can be unlinked from the middle.
+//
+// Aging is driven by deadlines: ready user program threads are also
+// kept in a heap ordered by when they started waiting, so the timer
+// only looks at the threads that are due for a promotion.
 
 class Scheduler {
    public:
@@ -32,13 +65,34 @@ class Scheduler {
                                 // running needs to be deleted
     void Print();               // Print contents of ready list
 
+    void SetPriority(Thread* thread, int priority);
+    // Change a thread's priority, moving it
+    // to the right queue if it is ready
+
+    void Age();  // Raise the priority of threads that
+                 // have waited too long; called on
+                 // each timer interrupt
+
+    bool IsEmpty(int level);  // Is ready queue L[level] empty?
+
+    static int LevelOf(int priority);  // Which queue (1, 2 or 3)
+                                       // a priority belongs to
+
     // SelfTest for scheduler is implemented in class Thread
-    List<Thread*>* L3;  // queue of threads that are ready to run,
-                               // but not running
-    SortedList<Thread*>* L2;
-    SortedList<Thread*>* L1;
+
    private:
-    
+    void Enqueue(Thread* thread);  // Put a thread on its ready queue
+    void Dequeue(Thread* thread);  // Take a thread off its ready queue
+
+    Heap<Thread*>* L1;                   // L1 ready threads
+    Heap<Thread*>* L2[NumL2Priorities];  // L2 ready threads; bucket i
+                                         // holds priority 99 - i
+    Bitmap* L2Busy;                      // which L2 buckets are non-empty
+    Thread* L3Head;                      // L3 ready threads, oldest first
+    Thread* L3Tail;
+    Heap<Thread*>* aging;                // ready user program threads,
+                                         // longest waiting first
+    Heap<Thread*>* due;                  // threads being aged, by ID
 
     Thread* toBeDestroyed;     // finishing thread to be destroyed
                                // by the next thread that runs
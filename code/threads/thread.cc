@@ -47,6 +47,18 @@ Thread::Thread(char *threadName, int threadID) {
                                  // of machine registers
     }
     space = NULL;
+    priority = 0;
+    startTick = 0.0;
+    burstTime = 0.0;
+    predictTime = 500.0;
+    remainingBurstTime = 0.0;
+    lastBurstTime = 0.0;
+    startWaitTime = 0.0;
+    waitTime = 0.0;
+    readyLevel = 0;
+    readyIndex = -1;
+    readyPrev = readyNext = NULL;
+    agingIndex = -1;
 }
 
 Thread::Thread(char *threadName, int threadID, int priority_) {
@@ -70,7 +82,10 @@ Thread::Thread(char *threadName, int threadID, int priority_) {
     lastBurstTime = 0.0;
     startWaitTime = 0.0;
     waitTime = 0.0;
-
+    readyLevel = 0;
+    readyIndex = -1;
+    readyPrev = readyNext = NULL;
+    agingIndex = -1;
 }
 
 //----------------------------------------------------------------------
@@ -88,6 +103,10 @@ Thread::Thread(char *threadName, int threadID, int priority_) {
 Thread::~Thread() {
     DEBUG(dbgThread, "Deleting thread: " << name);
     ASSERT(this != kernel->currentThread);
+    kernel->RemoveThread(this);
+    if (space != NULL && space->Detach(ID))
+        delete space;  // give back its memory, if no other
+                       // thread is running in it
     if (stack != NULL)
         DeallocBoundedArray((char *)stack, StackSize * sizeof(int));
 }
@@ -134,6 +134,8 @@ class Thread {
    public:
     void SaveUserState();     // save user-level register state
     void RestoreUserState();  // restore user-level register state
+    void SetUserRegister(int num, int value) { userRegisters[num] = value; }
+    // set it, before the thread first runs
 
     AddrSpace *space;  // User code this thread is running.
     
@@ -148,6 +150,12 @@ class Thread {
     double startWaitTime;
     double waitTime;
 
+    // Ready queue bookkeeping, maintained by the Scheduler
+    int readyLevel;   // ready queue (1, 2 or 3) we are on, 0 if none
+    int readyIndex;   // position in an L1 heap or an L2 bucket
+    Thread *readyPrev, *readyNext;  // neighbors on the L3 queue
+    int agingIndex;   // position in the Scheduler's aging heap
+
     
 };
 
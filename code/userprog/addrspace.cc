@@ -20,9 +20,17 @@
 #include "copyright.h"
 #include "machine.h"
 #include "main.h"
-#include "noff.h"
+#include "pager.h"
 #include <iostream>
 
+static int nextASID = 1;  // address space IDs are never reused,
+                          // so stale TLB entries can never match
+static int zeroFrame = -1;  // a physical page of zeroes, shared
+                            // copy-on-write by every address space
+
+#define ForkedStackPages ((unsigned int)divRoundUp(UserStackSize, PageSize))
+// pages in the stack of a forked thread
+
 //----------------------------------------------------------------------
 // SwapHeader
 // 	Do little endian to big endian conversion on the bytes in the
@@ -66,6 +74,21 @@ SwapHeader(NoffHeader *noffH) {
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace() {
+    frames = NULL;
+    numFrames = 0;
+    numReserved = 0;
+    argCount = 0;
+    argValues = NULL;
+    asid = nextASID++;
+    numPages = 0;
+    firstStackPage = 0;
+    for (int i = 0; i < MaxForkedThreads; i++) {
+        stackThread[i] = -1;
+    }
+    numThreads = 1;  // the one that runs the program
+    executable = NULL;
+    swapSlot = NULL;
+    text = NULL;
     pageTable = new TranslationEntry[NumPhysPages];
     for (int i = 0; i < NumPhysPages; i++) {
         pageTable[i].virtualPage = i;  // for now, virt page # = phys page #
@@ -79,18 +102,23 @@ AddrSpace::AddrSpace() {
     // zero out the entire address space
     bzero(kernel->machine->mainMemory, MemorySize);
 }
-AddrSpace::AddrSpace(int* _usedPhysPages, unsigned int* _numFreePhysPages) {
-    usedPhysPages = _usedPhysPages;
-    numFreePhysPages = _numFreePhysPages;
-    pageTable = new TranslationEntry[NumPhysPages];
-    for (int i = 0; i < NumPhysPages; i++) {
-        pageTable[i].virtualPage = i;  
-        pageTable[i].physicalPage = -1;
-        pageTable[i].valid = FALSE;
-        pageTable[i].use = FALSE;
-        pageTable[i].dirty = FALSE;
-        pageTable[i].readOnly = FALSE;
+AddrSpace::AddrSpace(FrameAllocator* _frames) {
+    frames = _frames;
+    numFrames = 0;
+    numReserved = 0;
+    argCount = 0;
+    argValues = NULL;
+    asid = nextASID++;
+    numPages = 0;
+    firstStackPage = 0;
+    for (int i = 0; i < MaxForkedThreads; i++) {
+        stackThread[i] = -1;
     }
+    numThreads = 1;  // the one that runs the program
+    executable = NULL;
+    swapSlot = NULL;
+    text = NULL;
+    pageTable = NULL;  // sized to fit the program by Load
 }
 
 //----------------------------------------------------------------------
@@ -99,11 +127,32 @@ AddrSpace::AddrSpace(int* _usedPhysPages, unsigned int* _numFreePhysPages) {
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace() {
-    for(int i = 0; i < numPages; i++){
-        usedPhysPages[pageTable[i].physicalPage] = 0;
-        (*numFreePhysPages)++;
+    if (kernel->tlbManager != NULL) {
+        kernel->tlbManager->FlushSpace(asid);
+    }
+    if (executable != NULL) {  // demand paged
+        kernel->pager->FreeSpace(this);
+        delete executable;
+        delete[] swapSlot;
+    } else if (frames != NULL) {
+        for(unsigned int i = 0; i < numPages; i++){
+            if (!pageTable[i].valid || (text != NULL && text->Contains(i)) ||
+                pageTable[i].physicalPage == zeroFrame)
+                continue;  // never loaded, or shared (code is freed
+                           // by the text cache)
+            frames->Free(pageTable[i].physicalPage);
+        }
+        frames->Unreserve(numReserved);
     }
-    delete pageTable;
+    ASSERT(numFrames == 0);  // every physical page given back
+    if (text != NULL) {
+        kernel->textCache->Release(text);
+    }
+    for (int i = 0; i < argCount; i++) {
+        delete[] argValues[i];
+    }
+    delete[] argValues;
+    delete[] pageTable;
 }
 
 //----------------------------------------------------------------------
@@ -121,6 +170,9 @@ int AddrSpace::Load(char *fileName) {
     OpenFile *executable = kernel->fileSystem->Open(fileName);
     NoffHeader noffH;
     unsigned int size;
+    unsigned int firstZeroPage, numZeroPages, maxPages;
+    int fileEnd;
+    bool reserved;
 
     if (executable == NULL) {
         cerr << "Unable to open file " << fileName << "\n";
@@ -147,14 +199,59 @@ int AddrSpace::Load(char *fileName) {
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
+    // the pages after the last one with anything from the file in
+    // it (uninitialized data and the stack) start out all zeroes
+    fileEnd = noffH.code.virtualAddr + noffH.code.size;
+    if (noffH.initData.size > 0)
+        fileEnd = max(fileEnd, noffH.initData.virtualAddr + noffH.initData.size);
+#ifdef RDATA
+    if (noffH.readonlyData.size > 0)
+        fileEnd = max(fileEnd, noffH.readonlyData.virtualAddr + noffH.readonlyData.size);
+#endif
+    firstZeroPage = min((unsigned int)divRoundUp(fileEnd, PageSize), numPages);
+    numZeroPages = numPages - firstZeroPage;
+
+    // one page table entry for each page of the program, and for
+    // the stacks of threads it may fork; none of them is in memory yet
+    firstStackPage = numPages;
+    maxPages = numPages + MaxForkedThreads * ForkedStackPages;
+    pageTable = new TranslationEntry[maxPages];
+    for (unsigned int i = 0; i < maxPages; i++) {
+        pageTable[i].virtualPage = i;
+        pageTable[i].physicalPage = -1;
+        pageTable[i].valid = FALSE;
+        pageTable[i].use = FALSE;
+        pageTable[i].dirty = FALSE;
+        pageTable[i].readOnly = FALSE;
+    }
+
+    if (kernel->pager != NULL) {
+        // With demand paging, nothing is read in yet: every page
+        // starts out invalid, and is loaded when it is first touched
+        // (see LoadPage).  The file stays open until we are deleted.
+        DEBUG(dbgAddr, "Demand paged address space: " << numPages << ", " << size);
+        swapSlot = new int[maxPages];
+        for (unsigned int i = 0; i < maxPages; i++) {
+            swapSlot[i] = -1;
+        }
+        this->executable = executable;
+        this->noffH = noffH;
+        MapSharedText(fileName, executable);
+        return TRUE;
+    }
+
     // ASSERT(numPages <= NumPhysPages);  // check we're not trying
     //                                    // to run anything too big --
     //                                    // at least until we have
     //                                    // virtual memory
     
-    //ASSERT(numPages <= *numFreePhysPages);
+    //ASSERT(numPages <= frames->NumFree());
     
-    if (!(numPages <= *numFreePhysPages)) {
+    // pages of code already in memory for another address space
+    // running this program need no new memory; the others do,
+    // sooner or later (and the page of zeroes, if there is none yet)
+    if (!(numPages - kernel->textCache->NumCachedPages(fileName, &noffH.code) +
+          (zeroFrame < 0 ? 1 : 0) <= (unsigned int)frames->NumFree())) {
         ExceptionHandler(MemoryLimitException);
         return FALSE;
     }
@@ -166,53 +263,320 @@ int AddrSpace::Load(char *fileName) {
     DEBUG(dbgAddr, "uninitData: " << noffH.uninitData.size << "\n");
     DEBUG(dbgAddr, "UserStackSize: " << UserStackSize << "\n");
 
+    this->noffH = noffH;
+    MapSharedText(fileName, executable);
+
+    // the zero pages all map the page of zeroes, read-only, until
+    // they are written (see CopyOnWrite); the memory for the copies
+    // is set aside now, so that they cannot run out of it
+    if (zeroFrame < 0) {
+        zeroFrame = frames->Allocate(NULL);
+        bzero(&kernel->machine->mainMemory[zeroFrame * PageSize], PageSize);
+    }
+    numReserved = numZeroPages;
+    reserved = frames->Reserve(numReserved);
+    ASSERT(reserved);  // we checked there was room
+    for (unsigned int i = firstZeroPage; i < numPages; i++) {
+        pageTable[i].physicalPage = zeroFrame;
+        pageTable[i].valid = TRUE;
+        pageTable[i].readOnly = TRUE;
+    }
 
-    unsigned int j = 0;
+    // then, copy the rest of the code and the data segments into
+    // memory, a page at a time, since the physical pages need not
+    // be contiguous.  Still, try for a run of them first: that is
+    // one search of the free pages instead of one for each page.
+    int numPrivate = firstZeroPage - ((text != NULL) ? text->numPages : 0);
+    int run = (numPrivate > 0) ? frames->AllocateRun(numPrivate, this) : -1;
     for(int i=0;i<numPages;i++)
     {  
-        while(j < NumPhysPages && usedPhysPages[j] == 1 ) j++;
-        usedPhysPages[j] = 1;
-        (*numFreePhysPages)--;
-        bzero(&kernel->machine->mainMemory[j * PageSize], PageSize);
+        if (pageTable[i].valid)
+            continue;  // shared code, or zeroes
+        int j = (run >= 0) ? run++ : frames->Allocate(this);
+        ASSERT(j >= 0);  // we checked there was room
+        LoadPage(executable, i, j);
+        kernel->machine->InvalidateDecodedPage(j);
         pageTable[i].physicalPage = j;
         pageTable[i].valid = TRUE;
     }
 
-    
+    delete executable;  // close file
+    return TRUE;        // success
+}
 
+//----------------------------------------------------------------------
+// AddrSpace::MapSharedText
+// 	Map the pages that hold nothing but code to physical pages
+//	shared with every other address space running the same program,
+//	loading them if this is the first one.  They are read-only, so
+//	no address space can change them under the others.
+//
+//	Assumes the NOFF header has been read in.
+//
+//	"fileName" -- the name of the program's executable
+//	"file" -- the executable, to read the code from
+//----------------------------------------------------------------------
 
-    // then, copy in the code and data segments into memory
-    // Note: this code assumes that virtual address = physical address
-    if (noffH.code.size > 0) {
-        DEBUG(dbgAddr, "Initializing code segment.");
-        DEBUG(dbgAddr, noffH.code.virtualAddr << ", " << noffH.code.size);
-        // executable->ReadAt(
-        //     &(kernel->machine->mainMemory[noffH.code.virtualAddr]),
-        //     noffH.code.size, noffH.code.inFileAddr);
-        unsigned int paddr;
-        AddrSpace::Translate(noffH.code.virtualAddr, &paddr, TRUE);
-        executable->ReadAt(&(kernel->machine->mainMemory[paddr]),noffH.code.size, noffH.code.inFileAddr);    
+void AddrSpace::MapSharedText(char *fileName, OpenFile *file) {
+    text = kernel->textCache->Acquire(fileName, file, &noffH.code);
+    if (text == NULL) {
+        return;  // not even one page of code to share
     }
-    if (noffH.initData.size > 0) {
-        DEBUG(dbgAddr, "Initializing data segment.");
-        DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-        unsigned int paddr;
-        AddrSpace::Translate(noffH.initData.virtualAddr, &paddr, TRUE);
-        executable->ReadAt(&(kernel->machine->mainMemory[paddr]),noffH.initData.size, noffH.initData.inFileAddr);
+    DEBUG(dbgAddr, "Sharing code pages " << text->firstPage << " to "
+                   << text->firstPage + text->numPages - 1);
+    for (int i = 0; i < text->numPages; i++) {
+        TranslationEntry *entry = &pageTable[text->firstPage + i];
+        entry->physicalPage = text->Frame(text->firstPage + i);
+        entry->valid = TRUE;
+        entry->readOnly = TRUE;
     }
+}
 
-#ifdef RDATA
-    if (noffH.readonlyData.size > 0) {
-        DEBUG(dbgAddr, "Initializing read only data segment.");
-        DEBUG(dbgAddr, noffH.readonlyData.virtualAddr << ", " << noffH.readonlyData.size);
-        unsigned int paddr;
-        AddrSpace::Translate(noffH.readonlyData.virtualAddr, &paddr, TRUE);
-        executable->ReadAt(&(kernel->machine->mainMemory[paddr]),noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	Copy into a physical page the part of a segment of the
+//	executable that falls in a virtual page, if any.
+//
+//	"file" -- the executable
+//	"segment" -- the segment, from the NOFF header
+//	"vpn" -- the virtual page
+//	"page" -- where the physical page is in main memory
+//----------------------------------------------------------------------
+
+void AddrSpace::LoadSegment(OpenFile *file, Segment *segment, unsigned int vpn,
+                            char *page) {
+    int pageStart = vpn * PageSize;
+    int start = max(pageStart, segment->virtualAddr);
+    int end = min(pageStart + PageSize, segment->virtualAddr + segment->size);
+
+    if (start < end) {
+        file->ReadAt(page + (start - pageStart), end - start,
+                     segment->inFileAddr + (start - segment->virtualAddr));
     }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPage
+// 	Fill a physical page with what a virtual page holds when the
+//	program starts: whatever parts of the code and data segments
+//	fall in it, and zeroes everywhere else (uninitialized data and
+//	the stack).
+//
+//	"file" -- the executable
+//	"vpn" -- the virtual page
+//	"frame" -- the physical page to fill
+//----------------------------------------------------------------------
+
+void AddrSpace::LoadPage(OpenFile *file, unsigned int vpn, int frame) {
+    char *page = &kernel->machine->mainMemory[frame * PageSize];
+
+    bzero(page, PageSize);
+    LoadSegment(file, &noffH.code, vpn, page);
+    LoadSegment(file, &noffH.initData, vpn, page);
+#ifdef RDATA
+    LoadSegment(file, &noffH.readonlyData, vpn, page);
 #endif
+}
 
-    delete executable;  // close file
-    return TRUE;        // success
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Handle a write to a read-only page.  If the page is one that
+//	starts out all zeroes, and is still mapped to the shared page of
+//	zeroes, give it a physical page of its own (set aside when the
+//	program was loaded) and make it writable.  Afterwards the
+//	faulting instruction can simply be restarted.
+//
+//	Returns FALSE if the page really is read-only (such as code).
+//
+//	"vpn" -- the virtual page written to
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyOnWrite(unsigned int vpn) {
+    TranslationEntry *entry = PageTableEntry(vpn);
+    int frame;
+
+    if (entry == NULL || !entry->valid || !entry->readOnly ||
+        entry->physicalPage != zeroFrame) {
+        return FALSE;
+    }
+    if (kernel->tlbManager != NULL) {
+        kernel->tlbManager->FlushPage(entry);  // it maps the old page
+    }
+    frame = frames->AllocateReserved(this);
+    numReserved--;
+    DEBUG(dbgAddr, "Copy on write of virtual page " << vpn << " to frame " << frame);
+    bzero(&kernel->machine->mainMemory[frame * PageSize], PageSize);
+    kernel->machine->InvalidateDecodedPage(frame);
+
+    entry->physicalPage = frame;
+    entry->readOnly = FALSE;
+    kernel->machine->FlushTranslations();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetArguments
+// 	Remember the arguments to pass to the program's main(), to be
+//	copied onto its stack when it starts running.
+//
+//	"argc" -- how many arguments
+//	"argv" -- the arguments, allocated with new[]; they (and the
+//		array) are deleted along with the address space
+//----------------------------------------------------------------------
+
+void AddrSpace::SetArguments(int argc, char **argv) {
+    argCount = argc;
+    argValues = argv;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ArgumentsFit
+// 	Return TRUE if PushArguments can copy these arguments onto a
+//	program's stack without running over into the program's data.
+//	They may take up at most half of the stack; the rest is left
+//	for main() and what it calls.
+//
+//	Below the stack top (which is 16 bytes below the end of the
+//	address space) go the strings, up to 3 bytes to align the
+//	pointers, the pointers and the NULL after them, and 16 bytes
+//	for main to save its arguments in.
+//
+//	"argc", "argv" -- the arguments
+//----------------------------------------------------------------------
+
+bool AddrSpace::ArgumentsFit(int argc, char **argv) {
+    int size = 16 + 3 + (argc + 1) * 4 + 16;
+
+    for (int i = 0; i < argc; i++) {
+        size += strlen(argv[i]) + 1;
+    }
+    return size <= UserStackSize / 2;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddStack
+// 	Give a thread forked to run in this address space a stack of its
+//	own.  The stacks go after the end of the program's own, in room
+//	left for them in the page table when the program was loaded; a
+//	stack whose thread is gone is given to the next one.
+//
+//	A new stack starts out all zeroes, like the program's own: with
+//	demand paging, its pages are filled when first touched; otherwise
+//	they map the page of zeroes copy-on-write, and memory for their
+//	copies is set aside now.  A stack used before is cleared: with
+//	demand paging its pages are given back, to be filled again;
+//	otherwise the ones already copied are zeroed.
+//
+//	Returns the address just past the top of the stack, or -1 if
+//	the program already has MaxForkedThreads threads, or there is not
+//	enough memory.
+//
+//	"threadID" -- the thread the stack is for
+//----------------------------------------------------------------------
+
+int AddrSpace::AddStack(int threadID) {
+    unsigned int first;
+    int slot;
+
+    if (frames == NULL || pageTable == NULL) {
+        return -1;  // the whole of memory is ours; no room to grow
+    }
+    for (slot = 0; slot < MaxForkedThreads && stackThread[slot] >= 0; slot++)
+        ;
+    if (slot == MaxForkedThreads) {
+        return -1;
+    }
+    first = firstStackPage + slot * ForkedStackPages;
+    if (first >= numPages) {  // the stack has not been used before
+        if (executable == NULL) {
+            if (!frames->Reserve(ForkedStackPages)) {
+                return -1;
+            }
+            numReserved += ForkedStackPages;
+            for (unsigned int i = first; i < first + ForkedStackPages; i++) {
+                pageTable[i].physicalPage = zeroFrame;
+                pageTable[i].valid = TRUE;
+                pageTable[i].readOnly = TRUE;
+            }
+        }
+        numPages = first + ForkedStackPages;
+        RestoreState();  // the page table is bigger now
+    } else if (executable != NULL) {
+        kernel->pager->FreePages(this, first, ForkedStackPages);
+    } else {
+        for (unsigned int i = first; i < first + ForkedStackPages; i++) {
+            if (pageTable[i].physicalPage != zeroFrame) {
+                bzero(&kernel->machine->mainMemory[pageTable[i].physicalPage * PageSize],
+                      PageSize);
+                kernel->machine->InvalidateDecodedPage(pageTable[i].physicalPage);
+            }
+        }
+    }
+    DEBUG(dbgAddr, "Stack of thread " << threadID << " at pages " << first
+                   << " to " << first + ForkedStackPages - 1);
+    stackThread[slot] = threadID;
+    numThreads++;
+    return (first + ForkedStackPages) * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Detach
+// 	Note that a thread running in this address space is going away,
+//	so that its stack (if it was forked) can be used again.  Returns
+//	TRUE if no thread is left, and the address space can be deleted.
+//
+//	"threadID" -- the thread
+//----------------------------------------------------------------------
+
+bool AddrSpace::Detach(int threadID) {
+    for (int i = 0; i < MaxForkedThreads; i++) {
+        if (stackThread[i] == threadID) {
+            stackThread[i] = -1;
+        }
+    }
+    numThreads--;
+    return numThreads == 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PushArguments
+// 	Copy the arguments for main() to the top of the user stack: the
+//	strings, then the array of pointers to them, ending with NULL.
+//	main(argc, argv) finds them in r4 and r5, which Start leaves
+//	alone.
+//
+//	This is done through the address translation, since the stack
+//	pages may not be in memory yet, or still be shared copy-on-
+//	write; when the translation fails, the exception has been
+//	handled, and the write need only be tried again.
+//----------------------------------------------------------------------
+
+void AddrSpace::PushArguments() {
+    Machine *machine = kernel->machine;
+    int sp = machine->ReadRegister(StackReg);
+    int *argAddr = new int[argCount];
+    int i, j, len;
+
+    for (i = 0; i < argCount; i++) {
+        len = strlen(argValues[i]) + 1;
+        sp -= len;
+        for (j = 0; j < len; j++) {
+            while (!machine->WriteMem(sp + j, 1, argValues[i][j])) {
+            }
+        }
+        argAddr[i] = sp;
+    }
+    sp = (sp & ~3) - (argCount + 1) * 4;  // the pointers are words
+    for (i = 0; i <= argCount; i++) {
+        while (!machine->WriteMem(sp + 4 * i, 4, (i < argCount) ? argAddr[i] : 0)) {
+        }
+    }
+    delete[] argAddr;
+
+    machine->WriteRegister(4, argCount);
+    machine->WriteRegister(5, sp);
+    machine->WriteRegister(StackReg, sp - 16);  // room for main to
+                                                // save its arguments
 }
 
 //----------------------------------------------------------------------
@@ -229,6 +593,9 @@ void AddrSpace::Execute(char *fileName) {
 
     this->InitRegisters();  // set the initial register values
     this->RestoreState();   // load page table register
+    if (argCount > 0) {
+        this->PushArguments();
+    }
 
     kernel->machine->Run();  // jump to the user progam
 
@@ -286,12 +653,20 @@ void AddrSpace::SaveState() {}
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//      to forget the translations it cached from the old one.  If
+//      there is a TLB, just tell it which address space is running;
+//      our TLB entries are tagged, so they need not be flushed.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() {
-    kernel->machine->pageTable = pageTable;
-    kernel->machine->pageTableSize = numPages;
+    if (kernel->machine->tlb != NULL) {
+        kernel->machine->currentASID = asid;
+    } else {
+        kernel->machine->pageTable = pageTable;
+        kernel->machine->pageTableSize = numPages;
+    }
+    kernel->machine->FlushTranslations();
 }
 
 //----------------------------------------------------------------------
@@ -335,7 +710,7 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite) {
 
     *paddr = pfn * PageSize + offset;
 
-    ASSERT((*paddr < MemorySize));
+    ASSERT((*paddr < (unsigned int)MemorySize));
 
     // cerr << " -- AddrSpace::Translate(): vaddr: " << vaddr <<
     //   ", paddr: " << *paddr << "\n";
@@ -15,14 +15,19 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "frameallocator.h"
 #include "machine.h"
+#include "noff.h"
+#include "textcache.h"
 
 #define UserStackSize 1024  // increase this as necessary!
+#define MaxForkedThreads 8  // threads a program can have forked
+                            // (ThreadFork) and running at once
 
 class AddrSpace {
    public:
     AddrSpace();   // Create an address space.
-    AddrSpace(int* _usedPhysPages, unsigned int* _numFreePhysPages);   // Create an address space.
+    AddrSpace(FrameAllocator* _frames);   // Create an address space.
     ~AddrSpace();  // De-allocate an address space
     
 
@@ -31,10 +36,34 @@ class AddrSpace {
                                 // a file
                                 // return false if not found
 
+    void LoadPage(OpenFile *file, unsigned int vpn, int frame);
+    // Fill a physical page with the initial
+    // contents of a virtual page, read from
+    // the executable
+
     void Execute(char *fileName);  // Run a program
                                    // assumes the program has already
                                    // been loaded
 
+    void SetArguments(int argc, char **argv);
+    // Arguments to pass to main() when the
+    // program is run; the strings become ours
+    static bool ArgumentsFit(int argc, char **argv);
+    // Is there room for them on the stack?
+
+    int AddStack(int threadID);
+    // Give a thread forked in this address
+    // space a stack of its own; return the
+    // address of its top, or -1 if no room
+    bool Detach(int threadID);
+    // A thread running in this address space
+    // is going away; TRUE if it was the last
+
+    bool CopyOnWrite(unsigned int vpn);
+    // Give a page shared copy-on-write a
+    // physical page of its own, after a
+    // write to it.  FALSE if it isn't one.
+
     void SaveState();     // Save/restore address space-specific
     void RestoreState();  // info on a context switch
 
@@ -43,15 +72,56 @@ class AddrSpace {
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
+    TranslationEntry *PageTableEntry(unsigned int vpn) {
+        return (vpn < numPages) ? &pageTable[vpn] : NULL;
+    }
+    // The page table entry for a virtual page,
+    // or NULL if it is outside the address space
+
+    int GetASID() { return asid; }  // which TLB entries are ours
+
+    int NumFrames() { return numFrames; }
+    // how many physical pages we hold
+
    private:
     TranslationEntry *pageTable;  // Assume linear page table translation
                                   // for now!
     unsigned int numPages;        // Number of pages in the virtual
                                   // address space
-    int* usedPhysPages;
-    unsigned int* numFreePhysPages;
+    unsigned int firstStackPage;  // Where the stacks of forked threads
+                                  // go; the page table has room for
+                                  // MaxForkedThreads of them
+    int stackThread[MaxForkedThreads];  // the thread using each of
+                                        // those stacks, or -1
+    int numThreads;               // Threads running in this space
+    int asid;                     // Address space ID, to tag our
+                                  // TLB entries with
+    OpenFile *executable;         // With demand paging, where pages
+                                  // are loaded from; NULL otherwise
+    NoffHeader noffH;             // and where the segments are in it
+    int *swapSlot;                // Where each page is in swap, or -1
+    SharedText *text;             // Code pages shared with other
+                                  // address spaces, or NULL
+    FrameAllocator* frames;       // Where our physical pages come from
+    int numFrames;                // Physical pages charged to us
+    int numReserved;              // Pages set aside for copies of
+                                  // the copy-on-write pages
+    int argCount;                 // Arguments for main(), or 0
+    char **argValues;
     void InitRegisters();  // Initialize user-level CPU registers,
                            // before jumping to user code
+    void PushArguments();  // Copy the arguments onto the stack
+    void MapSharedText(char *fileName, OpenFile *file);
+    // Map the code pages shared with other
+    // address spaces running the program
+
+    void LoadSegment(OpenFile *file, Segment *segment, unsigned int vpn,
+                     char *page);
+    // Copy the part of a segment that is in
+    // a virtual page into a physical page
+
+    friend class Pager;           // manages executable and swapSlot
+    friend class FrameAllocator;  // keeps numFrames up to date
 };
 
 #endif  // ADDRSPACE_H
@@ -24,7 +24,16 @@
 #include "copyright.h"
 #include "ksyscall.h"
 #include "main.h"
+#include "pager.h"
 #include "syscall.h"
+#include "userbuffer.h"
+
+const int MaxArgSize = 128;  // longest file name, program name or
+                             // argument passed to a system call
+const int MaxArgs = 16;      // most arguments ExecV passes on
+const int PrintChunkSize = 4096;  // PrintString looks for the end of
+                                  // the string this far at a time
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -76,12 +85,25 @@ void ExceptionHandler(ExceptionType which) {
                     return;
                     ASSERTNOTREACHED();
                     break;
+                case SC_PrintString:
+                    DEBUG(dbgSys, "Print String\n");
+                    val = kernel->machine->ReadRegister(4);
+                    SysPrintString(val, PrintChunkSize);
+                    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+                    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    return;
+                    ASSERTNOTREACHED();
+                    break;
                 case SC_MSG:
                     DEBUG(dbgSys, "Message received.\n");
                     val = kernel->machine->ReadRegister(4);
                     {
-                        char *msg = &(kernel->machine->mainMemory[val]);
-                        cout << msg << endl;
+                        char *msg = UserBuffer::ReadString(val, MaxArgSize);
+                        if (msg != NULL) {
+                            cout << msg << endl;
+                            delete[] msg;
+                        }
                     }
                     kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
                     kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
@@ -93,8 +115,9 @@ void ExceptionHandler(ExceptionType which) {
                     DEBUG(dbgSys, "SC_Create\n");
                     val = kernel->machine->ReadRegister(4);
                     {
-                        char *filename = &(kernel->machine->mainMemory[val]);
-                        status = SysCreate(filename);
+                        char *filename = UserBuffer::ReadString(val, MaxArgSize);
+                        status = (filename != NULL) ? SysCreate(filename) : 0;
+                        delete[] filename;
                         kernel->machine->WriteRegister(2, (int)status);
                     }
                     kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
@@ -107,8 +130,13 @@ void ExceptionHandler(ExceptionType which) {
                     DEBUG(dbgSys, "SC_Open\n");
                     val = kernel->machine->ReadRegister(4);
                     {
-                        char *filename = &(kernel->machine->mainMemory[val]);
-                        fileID = SysOpen(filename);
+                        // if the file is opened, the open file table
+                        // keeps the name
+                        char *filename = UserBuffer::ReadString(val, MaxArgSize);
+                        fileID = (filename != NULL) ? SysOpen(filename) : -1;
+                        if (fileID < 0) {
+                            delete[] filename;
+                        }
                         kernel->machine->WriteRegister(2, (int)fileID);
                     }
                     
@@ -123,12 +151,13 @@ void ExceptionHandler(ExceptionType which) {
                     
                     {
                         val = kernel->machine->ReadRegister(4);
-                        char* buffer = &(kernel->machine->mainMemory[val]);
+                        int addr = val;
                         val = kernel->machine->ReadRegister(5);
                         int size = val;
                         val = kernel->machine->ReadRegister(6);
                         int fid = val;
-                        numChar = SysWrite(buffer, size, fid);
+                        UserBuffer buffer(addr, size, FALSE);
+                        numChar = buffer.IsValid() ? SysWrite(&buffer, fid) : -1;
                         kernel->machine->WriteRegister(2, numChar);
                         
                     }
@@ -160,13 +189,14 @@ void ExceptionHandler(ExceptionType which) {
                     
                     {
                         val = kernel->machine->ReadRegister(4);
-                        char* buffer = &(kernel->machine->mainMemory[val]);
+                        int addr = val;
                         val = kernel->machine->ReadRegister(5);
                         int size = val;
                         val = kernel->machine->ReadRegister(6);
                         int fid = val;
                         
-                        numChar = SysRead(buffer, size, fid);
+                        UserBuffer buffer(addr, size, TRUE);
+                        numChar = buffer.IsValid() ? SysRead(&buffer, fid) : -1;
                         kernel->machine->WriteRegister(2, numChar);
                         
                     }
@@ -200,17 +230,142 @@ void ExceptionHandler(ExceptionType which) {
                     return;
                     ASSERTNOTREACHED();
                     break;
+                case SC_Exec:
+                    DEBUG(dbgSys, "SC_Exec\n");
+                    val = kernel->machine->ReadRegister(4);
+                    {
+                        char **argv = new char *[1];
+                        argv[0] = UserBuffer::ReadString(val, MaxArgSize);
+                        if (argv[0] != NULL) {
+                            programID = SysExecV(1, argv);
+                        } else {
+                            delete[] argv;
+                            programID = -1;
+                        }
+                        kernel->machine->WriteRegister(2, programID);
+                    }
+                    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+                    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    return;
+                    ASSERTNOTREACHED();
+                    break;
+                case SC_ExecV:
+                    DEBUG(dbgSys, "SC_ExecV\n");
+                    {
+                        int argc = kernel->machine->ReadRegister(4);
+                        int argvAddr = kernel->machine->ReadRegister(5);
+                        char **argv;
+                        int i;
+
+                        programID = -1;
+                        if (argc >= 1 && argc <= MaxArgs) {
+                            argv = new char *[argc];
+                            for (i = 0; i < argc; i++) {
+                                int argAddr;
+                                if (!UserBuffer::ReadWord(argvAddr + 4 * i, &argAddr) ||
+                                    (argv[i] = UserBuffer::ReadString(argAddr, MaxArgSize)) == NULL) {
+                                    break;
+                                }
+                            }
+                            if (i == argc && AddrSpace::ArgumentsFit(argc, argv)) {
+                                programID = SysExecV(argc, argv);
+                            } else {
+                                while (--i >= 0) {
+                                    delete[] argv[i];
+                                }
+                                delete[] argv;
+                            }
+                        }
+                        kernel->machine->WriteRegister(2, programID);
+                    }
+                    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+                    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    return;
+                    ASSERTNOTREACHED();
+                    break;
+                case SC_Join:
+                    DEBUG(dbgSys, "SC_Join\n");
+                    val = kernel->machine->ReadRegister(4);
+                    status = SysJoin(val);
+                    kernel->machine->WriteRegister(2, status);
+                    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+                    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    return;
+                    ASSERTNOTREACHED();
+                    break;
+                case SC_ThreadFork:
+                    DEBUG(dbgSys, "SC_ThreadFork\n");
+                    val = kernel->machine->ReadRegister(4);
+                    programID = SysThreadFork(val);
+                    kernel->machine->WriteRegister(2, programID);
+                    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+                    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    return;
+                    ASSERTNOTREACHED();
+                    break;
+                case SC_ThreadYield:
+                    DEBUG(dbgSys, "SC_ThreadYield\n");
+                    kernel->currentThread->Yield();
+                    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+                    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    return;
+                    ASSERTNOTREACHED();
+                    break;
+                case SC_ThreadJoin:
+                    DEBUG(dbgSys, "SC_ThreadJoin\n");
+                    val = kernel->machine->ReadRegister(4);
+                    status = SysJoin(val);
+                    kernel->machine->WriteRegister(2, status);
+                    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+                    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+                    return;
+                    ASSERTNOTREACHED();
+                    break;
+                case SC_ThreadExit:
+                    DEBUG(dbgSys, "SC_ThreadExit\n");
+                    val = kernel->machine->ReadRegister(4);
+                    kernel->ExitProgram(val);
+                    break;
                 case SC_Exit:
                     DEBUG(dbgAddr, "Program exit\n");
                     val = kernel->machine->ReadRegister(4);
                     cout << "return value:" << val << endl;
-                    kernel->currentThread->Finish();
+                    kernel->ExitProgram(val);
                     break;
                 default:
                     cerr << "Unexpected system call " << type << "\n";
                     break;
             }
             break;
+        case PageFaultException:
+            // with a TLB, most page faults are just TLB misses, and
+            // with demand paging, the page may not be in memory yet;
+            // once either is fixed, return to re-run the instruction
+            val = kernel->machine->ReadRegister(BadVAddrReg);
+            if (kernel->tlbManager != NULL && kernel->tlbManager->Refill(val)) {
+                return;
+            }
+            if (kernel->pager != NULL && kernel->pager->PageIn((unsigned)val / PageSize)) {
+                return;
+            }
+            cerr << "Unexpected user mode exception " << (int)which << "\n";
+            break;
+        case ReadOnlyException:
+            // a write to a page shared copy-on-write: once the address
+            // space has its own copy, return to re-run the instruction
+            val = kernel->machine->ReadRegister(BadVAddrReg);
+            if (kernel->currentThread->space != NULL &&
+                kernel->currentThread->space->CopyOnWrite((unsigned)val / PageSize)) {
+                return;
+            }
+            cerr << "Unexpected user mode exception " << (int)which << "\n";
+            break;
         default:
             cerr << "Unexpected user mode exception " << (int)which << "\n";
             break;
@@ -0,0 +1,181 @@
+// frameallocator.cc
+//	Routines to allocate the physical pages of main memory to
+//	address spaces, and to keep track of who has each one.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "frameallocator.h"
+
+#include "addrspace.h"
+#include "copyright.h"
+#include "debug.h"
+
+//----------------------------------------------------------------------
+// FrameAllocator::FrameAllocator
+// 	Initialize the allocator, with every physical page free.
+//
+//	"numFrames" is the number of physical pages.
+//----------------------------------------------------------------------
+
+FrameAllocator::FrameAllocator(int numFrames) {
+    used = new Bitmap(numFrames);
+    owner = new AddrSpace *[numFrames];
+    pinCount = new int[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+        owner[i] = NULL;
+        pinCount[i] = 0;
+    }
+    numFree = numFrames;
+    numReserved = 0;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::~FrameAllocator
+// 	De-allocate the allocator.
+//----------------------------------------------------------------------
+
+FrameAllocator::~FrameAllocator() {
+    delete used;
+    delete[] owner;
+    delete[] pinCount;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Charge
+// 	Add to (or take away from) the number of physical pages an
+//	address space holds.
+//
+//	"space" -- the address space, or NULL for none
+//	"count" -- how many pages it got (negative if it gave them up)
+//----------------------------------------------------------------------
+
+void FrameAllocator::Charge(AddrSpace *space, int count) {
+    if (space != NULL) {
+        space->numFrames += count;
+        ASSERT(space->numFrames >= 0);
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Allocate
+// 	Find a free physical page and give it to an address space.
+//	Return the page, or -1 if every page is in use.
+//
+//	"space" -- the address space, or NULL for none
+//----------------------------------------------------------------------
+
+int FrameAllocator::Allocate(AddrSpace *space) {
+    int frame;
+
+    if (NumFree() == 0) {
+        return -1;  // the rest are reserved
+    }
+    frame = used->FindAndSet();
+    ASSERT(frame >= 0);
+    owner[frame] = space;
+    numFree--;
+    Charge(space, 1);
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::AllocateReserved
+// 	Give an address space one of the physical pages set aside by
+//	Reserve.  There is sure to be one.
+//
+//	"space" -- the address space, or NULL for none
+//----------------------------------------------------------------------
+
+int FrameAllocator::AllocateReserved(AddrSpace *space) {
+    ASSERT(numReserved > 0);
+    numReserved--;
+    return Allocate(space);
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::AllocateRun
+// 	Find "count" free physical pages in a row and give them to an
+//	address space.  Return the first page, or -1 if there is no such
+//	run (even though there may be that many free pages).
+//
+//	"count" -- how many pages
+//	"space" -- the address space, or NULL for none
+//----------------------------------------------------------------------
+
+int FrameAllocator::AllocateRun(int count, AddrSpace *space) {
+    int first;
+
+    if (count > NumFree()) {
+        return -1;
+    }
+    first = used->FindClearRun(count);
+    if (first >= 0) {
+        for (int i = first; i < first + count; i++) {
+            used->Mark(i);
+            owner[i] = space;
+        }
+        numFree -= count;
+        Charge(space, count);
+    }
+    return first;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Free, FrameAllocator::FreeRun
+// 	Give back one physical page, or "count" of them starting at
+//	"first", taking them away from whoever holds them.
+//----------------------------------------------------------------------
+
+void FrameAllocator::Free(int frame) {
+    ASSERT(used->Test(frame) && pinCount[frame] == 0);
+    Charge(owner[frame], -1);
+    owner[frame] = NULL;
+    used->Clear(frame);
+    numFree++;
+}
+
+void FrameAllocator::FreeRun(int first, int count) {
+    for (int i = first; i < first + count; i++) {
+        Free(i);
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Reserve, FrameAllocator::Unreserve
+// 	Set aside "count" free physical pages, to be allocated later
+//	with AllocateReserved; or give back reservations that were not
+//	used.  Reserve returns FALSE (and reserves nothing) if there are
+//	not that many free pages.
+//----------------------------------------------------------------------
+
+bool FrameAllocator::Reserve(int count) {
+    if (count > NumFree()) {
+        return FALSE;
+    }
+    numReserved += count;
+    return TRUE;
+}
+
+void FrameAllocator::Unreserve(int count) {
+    numReserved -= count;
+    ASSERT(numReserved >= 0);
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::SetOwner
+// 	Move a physical page that is in use from one address space to
+//	another, as when the pager takes a page away from one to bring
+//	in a page of another.
+//
+//	"frame" -- the physical page
+//	"space" -- its new owner, or NULL for none
+//----------------------------------------------------------------------
+
+void FrameAllocator::SetOwner(int frame, AddrSpace *space) {
+    ASSERT(used->Test(frame));
+    Charge(owner[frame], -1);
+    owner[frame] = space;
+    Charge(space, 1);
+}
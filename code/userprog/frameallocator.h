@@ -0,0 +1,89 @@
+// frameallocator.h
+//	Data structures to keep track of the physical pages of main
+//	memory: which are free, and which address space each page in
+//	use belongs to.
+//
+//	The free pages are kept in a bitmap, searched a word at a time,
+//	so finding a free page stays cheap even when there are many of
+//	them.  Each address space counts the physical pages it holds,
+//	so it can check that it gave them all back.
+//
+//	Free pages can also be reserved, for pages an address space is
+//	sure to need later (such as copies of pages it now shares copy-
+//	on-write): they are no longer counted as free, so getting them
+//	later cannot fail.
+//
+//	A page in use can be pinned, while the kernel reads or writes it
+//	on behalf of a user program, so that the pager leaves it alone.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMEALLOCATOR_H
+#define FRAMEALLOCATOR_H
+
+#include "bitmap.h"
+#include "copyright.h"
+#include "debug.h"
+
+class AddrSpace;
+
+// The following class defines the allocator of physical pages
+// ("frames").  A page in use may belong to no address space (its
+// owner is NULL), for instance shared code kept by the kernel.
+
+class FrameAllocator {
+   public:
+    FrameAllocator(int numFrames);  // Initialize, with every page free
+    ~FrameAllocator();               // De-allocate the allocator
+
+    int Allocate(AddrSpace *space);
+    // Get a free physical page for "space";
+    // return -1 if memory is full
+    int AllocateRun(int count, AddrSpace *space);
+    // Get "count" free physical pages in a
+    // row; return the first, or -1 if there
+    // is no such run
+    int AllocateReserved(AddrSpace *space);
+    // Get a physical page set aside earlier
+    // with Reserve
+    void Free(int frame);                // Give back a physical page
+    void FreeRun(int first, int count);  // or several in a row
+
+    AddrSpace *Owner(int frame) { return owner[frame]; }
+    // Which address space a page belongs to
+    void SetOwner(int frame, AddrSpace *space);
+    // Give a page in use to another
+    // address space (or to none)
+
+    bool Reserve(int count);   // Set aside "count" free pages, if
+                               // there are that many
+    void Unreserve(int count); // Give back unused reservations
+
+    void Pin(int frame) { pinCount[frame]++; }
+    void Unpin(int frame) {
+        ASSERT(pinCount[frame] > 0);
+        pinCount[frame]--;
+    }
+    bool IsPinned(int frame) { return pinCount[frame] > 0; }
+    // Keep a page from being paged out, or
+    // let it be again (pins nest)
+
+    int NumFree() { return numFree - numReserved; }
+    // How many pages can be allocated?
+    bool IsFree(int frame) { return !used->Test(frame); }
+
+   private:
+    void Charge(AddrSpace *space, int count);  // count pages held
+
+    Bitmap *used;       // which physical pages are in use
+    AddrSpace **owner;  // who each one belongs to, or NULL
+    int *pinCount;      // how many times each one is pinned
+    int numFree;        // number of clear bits in "used"
+    int numReserved;    // how many of those are set aside
+};
+
+#endif  // FRAMEALLOCATOR_H
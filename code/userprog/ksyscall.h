@@ -13,6 +13,7 @@
 
 #include "kernel.h"
 #include "synchconsole.h"
+#include "userbuffer.h"
 
 void SysHalt() {
     kernel->interrupt->Halt();
@@ -24,6 +25,29 @@ void SysPrintInt(int val) {
     DEBUG(dbgTraCode, "In ksyscall.h:SysPrintInt, return from synchConsoleOut->PutInt, " << kernel->stats->totalTicks);
 }
 
+// The string is written to the console straight out of the user's
+// pages, a piece at a time, rather than a character at a time.  A
+// string longer than chunkSize is written chunkSize bytes at a time,
+// until its end, or a page that is not in the address space.
+
+void SysPrintString(int vaddr, int chunkSize) {
+    for (;;) {
+        int length = UserBuffer::StringLength(vaddr, chunkSize);
+        UserBuffer buffer(vaddr, (length >= 0) ? length : chunkSize, FALSE);
+
+        if (!buffer.IsValid()) {
+            return;
+        }
+        for (int i = 0; i < buffer.NumPieces(); i++) {
+            kernel->synchConsoleOut->PutBuffer(buffer.Piece(i), buffer.PieceSize(i));
+        }
+        if (length >= 0) {
+            return;
+        }
+        vaddr += chunkSize;
+    }
+}
+
 int SysAdd(int op1, int op2) {
     return op1 + op2;
 }
@@ -42,18 +66,59 @@ OpenFileId SysOpen(char *name)
     return kernel->fileSystem->OpenAFile(name);
 }
 
-int SysWrite(char *buffer, int size, int fid)
+// Read and Write go through the pieces of the user's buffer in order;
+// the file position moves along as they do, so it is as if the whole
+// buffer were done at once.
+
+int SysWrite(UserBuffer *buffer, int fid)
 {
-    return kernel->fileSystem->WriteFile(buffer, size, fid);
+    int total = 0;
+
+    for (int i = 0; i < buffer->NumPieces(); i++) {
+        int n = kernel->fileSystem->WriteFile(buffer->Piece(i), buffer->PieceSize(i), fid);
+        if (n < 0)
+            return (total > 0) ? total : n;
+        total += n;
+        if (n < buffer->PieceSize(i))
+            break;
+    }
+    return total;
 }
 
 int SysClose(int fid)
 {
     return kernel->fileSystem->CloseFile(fid);
 }
-int SysRead(char *buffer, int size, int fid)
+int SysRead(UserBuffer *buffer, int fid)
+{
+    int total = 0;
+
+    for (int i = 0; i < buffer->NumPieces(); i++) {
+        int n = kernel->fileSystem->ReadFile(buffer->Piece(i), buffer->PieceSize(i), fid);
+        if (n < 0)
+            return (total > 0) ? total : n;
+        total += n;
+        if (n < buffer->PieceSize(i))
+            break;  // end of file
+    }
+    return total;
+}
+
+int SysExecV(int argc, char **argv)
+{
+    // the child runs at its parent's priority
+    return kernel->ExecV(argc, argv, kernel->currentThread->priority);
+}
+
+int SysThreadFork(int func)
+{
+    // the new thread runs at its creator's priority
+    return kernel->ThreadFork(func, kernel->currentThread->priority);
+}
+
+int SysJoin(int id)
 {
-    return kernel->fileSystem->ReadFile(buffer, size, fid);
+    return kernel->Join(id);
 }
 
 
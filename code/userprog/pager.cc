@@ -0,0 +1,299 @@
+// pager.cc
+//	Routines to handle page faults, and to move pages between
+//	physical memory and the swap disk.
+//
+//	The swap disk is a separate simulated disk (stored in the UNIX
+//	file SWAP_<host id>), divided into slots of one page each.  An
+//	address space is given a slot for a page the first time the page
+//	is paged out dirty, and keeps it until the address space is
+//	deleted.
+//
+//	Page faults are handled one at a time: a thread waiting for the
+//	swap disk holds the pager lock, so no other thread can choose
+//	the same physical page, or page out the page being brought in.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "pager.h"
+
+#include "copyright.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// Pager::Pager
+// 	Initialize the pager: open the swap disk, and note that no
+//	physical page belongs to a paged address space yet.
+//
+//	"swapPolicy" -- how to order requests to the swap disk
+//----------------------------------------------------------------------
+
+Pager::Pager(DiskPolicy swapPolicy) {
+    ASSERT(PageSize % SectorSize == 0);
+    sectorsPerPage = PageSize / SectorSize;
+    swapDisk = new SynchDisk("SWAP", swapPolicy);
+    swapMap = new Bitmap(NumSectors / sectorsPerPage);
+    ownerPage = new unsigned int[NumPhysPages];
+    hand = 0;
+    lock = new Lock("pager");
+}
+
+//----------------------------------------------------------------------
+// Pager::~Pager
+// 	De-allocate the pager.
+//----------------------------------------------------------------------
+
+Pager::~Pager() {
+    delete swapDisk;
+    delete swapMap;
+    delete[] ownerPage;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Pager::ReadSwap, Pager::WriteSwap
+// 	Copy a page from a swap slot into a physical page, or back.
+//
+//	"slot" -- the swap slot
+//	"frame" -- the physical page
+//----------------------------------------------------------------------
+
+void Pager::ReadSwap(int slot, int frame) {
+    char *page = &kernel->machine->mainMemory[frame * PageSize];
+
+    swapDisk->ReadSectors(slot * sectorsPerPage, sectorsPerPage, page);
+}
+
+void Pager::WriteSwap(int slot, int frame) {
+    char *page = &kernel->machine->mainMemory[frame * PageSize];
+
+    swapDisk->WriteSectors(slot * sectorsPerPage, sectorsPerPage, page);
+}
+
+//----------------------------------------------------------------------
+// Pager::PageOut
+// 	Take the page in a physical page out of memory, writing it to
+//	swap if it has been modified.
+//
+//	All the bookkeeping is done before the page is written: its page
+//	table entry is marked invalid, so if its owner runs while we wait
+//	for the disk, it faults (and waits for us) rather than changing
+//	the page under us; and the physical page no longer belongs to
+//	the owner, so it stays ours even if the owner is deleted.
+//
+//	"frame" -- the physical page
+//----------------------------------------------------------------------
+
+void Pager::PageOut(int frame) {
+    AddrSpace *space = kernel->frames->Owner(frame);
+    unsigned int vpn = ownerPage[frame];
+    TranslationEntry *entry = space->PageTableEntry(vpn);
+    int slot = -1;
+
+    if (kernel->tlbManager != NULL) {
+        kernel->tlbManager->FlushPage(entry);  // collect the dirty bit
+    }
+    entry->valid = FALSE;
+    kernel->machine->FlushTranslations();
+
+    DEBUG(dbgAddr, "Paging out virtual page " << vpn << " from frame " << frame
+                                              << (entry->dirty ? ", dirty" : ""));
+    if (entry->dirty) {
+        if (space->swapSlot[vpn] < 0) {
+            space->swapSlot[vpn] = swapMap->FindAndSet();
+            ASSERT(space->swapSlot[vpn] >= 0);  // out of swap space!
+        }
+        slot = space->swapSlot[vpn];
+        entry->dirty = FALSE;
+    }
+    entry->physicalPage = -1;
+    kernel->frames->SetOwner(frame, NULL);
+
+    if (slot >= 0) {
+        WriteSwap(slot, frame);
+    }
+}
+
+//----------------------------------------------------------------------
+// Pager::FindFrame
+// 	Find a physical page for a page being brought in.  Use a free
+//	one if there is any; otherwise choose one with the clock
+//	algorithm, and page it out.
+//
+//	The clock hand sweeps over the physical pages, clearing use
+//	bits, until it finds a page whose use bit is already clear: one
+//	that has not been referenced since the hand last passed.  Pages
+//	the kernel is using on behalf of a user program are pinned, and
+//	skipped.
+//
+//	Two sweeps are enough to find a page if there is one to take,
+//	since the first clears every use bit.  If there is none (every
+//	page is pinned, or kept by the kernel), return -1.
+//----------------------------------------------------------------------
+
+int Pager::FindFrame() {
+    FrameAllocator *frames = kernel->frames;
+    TranslationEntry *entry;
+    int frame;
+
+    frame = frames->Allocate(NULL);
+    if (frame >= 0) {
+        return frame;
+    }
+
+    if (kernel->tlbManager != NULL) {
+        kernel->tlbManager->SyncBits();  // the TLB holds recent use bits
+    }
+    frame = -1;
+    for (int i = 0; i < 2 * NumPhysPages && frame < 0; i++) {
+        int candidate = hand;
+
+        hand = (hand + 1) % NumPhysPages;
+        if (frames->Owner(candidate) == NULL || frames->IsPinned(candidate)) {
+            continue;  // kept in memory by the kernel
+        }
+        entry = frames->Owner(candidate)->PageTableEntry(ownerPage[candidate]);
+        if (!entry->use) {
+            frame = candidate;
+        } else {
+            entry->use = FALSE;
+        }
+    }
+    // a cached translation would keep the hardware from setting the
+    // use bits we just cleared
+    kernel->machine->FlushTranslations();
+
+    if (frame < 0) {
+        cerr << "Out of physical memory: every page is pinned or kept by the kernel\n";
+        return -1;
+    }
+    PageOut(frame);
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// Pager::PageIn
+// 	Handle a page fault, by bringing a page of the current address
+//	space into memory.  Afterwards the faulting instruction can
+//	simply be restarted.
+//
+//	Returns FALSE if the page is outside the address space, or
+//	there is no physical page to bring it into.
+//
+//	"vpn" -- the virtual page that faulted
+//----------------------------------------------------------------------
+
+bool Pager::PageIn(unsigned int vpn) {
+    AddrSpace *space = kernel->currentThread->space;
+    TranslationEntry *entry;
+    int frame;
+
+    if (space == NULL || space->executable == NULL) {
+        return FALSE;  // not a demand paged address space
+    }
+    entry = space->PageTableEntry(vpn);
+    if (entry == NULL) {
+        return FALSE;
+    }
+
+    lock->Acquire();
+    if (!entry->valid) {
+        kernel->stats->numPageFaults++;
+        frame = FindFrame();
+        if (frame < 0) {
+            lock->Release();
+            return FALSE;
+        }
+        kernel->frames->SetOwner(frame, space);
+        ownerPage[frame] = vpn;
+
+        DEBUG(dbgAddr, "Paging in virtual page " << vpn << " to frame " << frame);
+        if (space->swapSlot[vpn] >= 0) {
+            ReadSwap(space->swapSlot[vpn], frame);
+        } else {
+            space->LoadPage(space->executable, vpn, frame);
+        }
+        kernel->machine->InvalidateDecodedPage(frame);
+
+        entry->physicalPage = frame;
+        entry->use = FALSE;
+        entry->dirty = FALSE;
+        entry->valid = TRUE;
+    }
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Pager::AllocateFrame
+// 	Find a physical page for the kernel to keep in memory (such as
+//	shared code).  Since no address space owns it, the clock never
+//	picks it; it must be given back to kernel->frames when done.
+//----------------------------------------------------------------------
+
+int Pager::AllocateFrame() {
+    int frame;
+
+    lock->Acquire();
+    frame = FindFrame();
+    lock->Release();
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// Pager::FreeSpace
+// 	Give back the physical pages and the swap slots of an address
+//	space that is being deleted.
+//
+//	"space" -- the address space
+//----------------------------------------------------------------------
+
+void Pager::FreeSpace(AddrSpace *space) {
+    for (unsigned int vpn = 0; vpn < space->numPages; vpn++) {
+        TranslationEntry *entry = space->PageTableEntry(vpn);
+
+        // shared code is in memory too, but belongs to no one
+        if (entry->valid && kernel->frames->Owner(entry->physicalPage) == space) {
+            kernel->frames->Free(entry->physicalPage);
+        }
+        if (space->swapSlot[vpn] >= 0) {
+            swapMap->Clear(space->swapSlot[vpn]);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Pager::FreePages
+// 	Give back the physical pages and the swap slots of some pages
+//	of the current address space, which it no longer needs: the next
+//	time one is referenced, it faults, and is filled with zeroes.
+//
+//	We hold the lock, so that none of the pages is being paged out.
+//
+//	"space" -- the address space
+//	"first" -- the first of the pages
+//	"count" -- how many pages
+//----------------------------------------------------------------------
+
+void Pager::FreePages(AddrSpace *space, unsigned int first, unsigned int count) {
+    lock->Acquire();
+    for (unsigned int vpn = first; vpn < first + count; vpn++) {
+        TranslationEntry *entry = space->PageTableEntry(vpn);
+
+        if (entry->valid && kernel->frames->Owner(entry->physicalPage) == space) {
+            if (kernel->tlbManager != NULL) {
+                kernel->tlbManager->FlushPage(entry);
+            }
+            kernel->frames->Free(entry->physicalPage);
+            entry->physicalPage = -1;
+            entry->valid = FALSE;
+        }
+        if (space->swapSlot[vpn] >= 0) {
+            swapMap->Clear(space->swapSlot[vpn]);
+            space->swapSlot[vpn] = -1;
+        }
+    }
+    kernel->machine->FlushTranslations();
+    lock->Release();
+}
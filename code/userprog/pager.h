@@ -0,0 +1,71 @@
+// pager.h
+//	Data structures for demand paging of user programs.
+//
+//	With demand paging, an address space starts with no pages in
+//	memory.  The first reference to a page causes a page fault, and
+//	the pager brings it in: from the swap disk if it has been paged
+//	out before, otherwise from the executable (or zero-filled).  When
+//	memory is full, a page is chosen to be paged out with the clock
+//	algorithm, using the use bits set by the hardware.  Only dirty
+//	pages are written to swap; clean ones can be read again from
+//	wherever they came from.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGER_H
+#define PAGER_H
+
+#include "addrspace.h"
+#include "bitmap.h"
+#include "copyright.h"
+#include "synch.h"
+#include "synchdisk.h"
+
+// The following class defines the page fault handler, along with the
+// swap disk.  The address space each physical page belongs to is kept
+// by kernel->frames; the pager keeps which of its pages it is.
+
+class Pager {
+   public:
+    Pager(DiskPolicy swapPolicy);  // Initialize the pager and its swap
+                                   // disk, scheduled by "swapPolicy"
+    ~Pager();  // De-allocate the pager
+
+    bool PageIn(unsigned int vpn);
+    // Handle a page fault on a virtual page
+    // of the current address space.  Return
+    // FALSE if the page is not in the space,
+    // or memory is full of pinned pages
+
+    int AllocateFrame();
+    // Get a physical page that is not to be
+    // paged out (it belongs to no address
+    // space), paging something else out if
+    // memory is full; -1 if nothing can be
+
+    void FreeSpace(AddrSpace *space);
+    // Give back the physical pages and swap
+    // space of an address space going away
+    void FreePages(AddrSpace *space, unsigned int first, unsigned int count);
+    // Give back those of some of its pages,
+    // which are zero-filled when next used
+
+   private:
+    int FindFrame();          // find a physical page to use,
+                              // paging one out if necessary
+    void PageOut(int frame);  // take a page out of memory
+    void ReadSwap(int slot, int frame);   // move a page between
+    void WriteSwap(int slot, int frame);  // swap and memory
+
+    SynchDisk *swapDisk;       // where paged out pages go
+    Bitmap *swapMap;           // which swap slots are in use
+    int sectorsPerPage;        // size of a swap slot
+    unsigned int *ownerPage;   // which virtual page of its owner
+                               // each physical page holds
+    int hand;                  // where the clock algorithm looks next
+    Lock *lock;                // one page fault handled at a time
+};
+
+#endif  // PAGER_H
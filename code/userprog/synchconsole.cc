@@ -72,6 +72,8 @@ SynchConsoleOutput::SynchConsoleOutput(char *outputFile) {
     consoleOutput = new ConsoleOutput(outputFile, this);
     lock = new Lock("console out");
     waitFor = new Semaphore("console out", 0);
+    next = NULL;
+    numLeft = 0;
 }
 
 //----------------------------------------------------------------------
@@ -91,40 +93,74 @@ SynchConsoleOutput::~SynchConsoleOutput() {
 //----------------------------------------------------------------------
 
 void SynchConsoleOutput::PutChar(char ch) {
-    lock->Acquire();
-    consoleOutput->PutChar(ch);
-    waitFor->P();
-    lock->Release();
+    PutBuffer(&ch, 1);
 }
 
+//----------------------------------------------------------------------
+// SynchConsoleOutput::PutInt
+//      Write a number in decimal to the console display, followed by
+//	a newline, waiting if necessary.  The digits are worked out
+//	here, from the right, rather than with sprintf.
+//----------------------------------------------------------------------
+
 void SynchConsoleOutput::PutInt(int value) {
-    char str[15];
-    int idx = 0;
-    // sprintf(str, "%d\n\0", value);  the true one
-    sprintf(str, "%d\n\0", value);  // simply for trace code
-    DEBUG(dbgTraCode, "In SynchConsoleOutput::PutChar, Before lock acquire");
-    lock->Acquire();
-    DEBUG(dbgTraCode, "In SynchConsoleOutput::PutChar, After lock acquire");
+    char str[12];  // sign, 10 digits and the newline
+    int idx = sizeof(str);
+    unsigned int n = (value < 0) ? -(unsigned int)value : value;
+
+    str[--idx] = '\n';
     do {
-        DEBUG(dbgTraCode, "In SynchConsoleOutput::PutChar, into consoleOutput->PutChar, " << kernel->stats->totalTicks);
-        consoleOutput->PutChar(str[idx]);
-        DEBUG(dbgTraCode, "In SynchConsoleOutput::PutChar, return from consoleOutput->PutChar, " << kernel->stats->totalTicks);
-        idx++;
-
-        DEBUG(dbgTraCode, "In SynchConsoleOutput::PutChar, into waitFor->P(), " << kernel->stats->totalTicks);
-        waitFor->P();
-        DEBUG(dbgTraCode, "In SynchConsoleOutput::PutChar, return form  waitFor->P(), " << kernel->stats->totalTicks);
-    } while (str[idx] != '\0');
+        str[--idx] = '0' + n % 10;
+        n /= 10;
+    } while (n != 0);
+    if (value < 0) {
+        str[--idx] = '-';
+    }
+    PutBuffer(&str[idx], sizeof(str) - idx);
+}
+
+//----------------------------------------------------------------------
+// SynchConsoleOutput::PutBuffer
+//      Write "size" characters to the console display, waiting until
+//	they have all been written.
+//
+//	The display still takes one character at a time, but only the
+//	first is put out here; CallBack puts out each of the rest when
+//	the one before is done.  So the whole buffer takes ConsoleTime
+//	per character, as before, but the lock is taken once and the
+//	thread sleeps and wakes up once, not once per character.
+//
+//	"buffer" -- the characters; must stay put until we return
+//	"size" -- how many of them
+//----------------------------------------------------------------------
+
+void SynchConsoleOutput::PutBuffer(char *buffer, int size) {
+    if (size <= 0) {
+        return;
+    }
+    lock->Acquire();
+    DEBUG(dbgTraCode, "In SynchConsoleOutput::PutBuffer, " << size << " chars, " << kernel->stats->totalTicks);
+    next = buffer + 1;
+    numLeft = size - 1;
+    consoleOutput->PutChar(buffer[0]);
+    waitFor->P();
+    DEBUG(dbgTraCode, "In SynchConsoleOutput::PutBuffer, done, " << kernel->stats->totalTicks);
     lock->Release();
 }
 
 //----------------------------------------------------------------------
 // SynchConsoleOutput::CallBack
 //      Interrupt handler called when it's safe to send the next
-//	character can be sent to the display.
+//	character can be sent to the display.  Sends it, if there is
+//	more of the buffer to go; otherwise wakes up the writer.
 //----------------------------------------------------------------------
 
 void SynchConsoleOutput::CallBack() {
     DEBUG(dbgTraCode, "In SynchConsoleOutput::CallBack(), " << kernel->stats->totalTicks);
-    waitFor->V();
+    if (numLeft > 0) {
+        numLeft--;
+        consoleOutput->PutChar(*next++);
+    } else {
+        waitFor->V();
+    }
 }
@@ -42,12 +42,18 @@ class SynchConsoleOutput : public CallBackObj {
 
     void PutChar(char ch);  // Write a character, waiting if necessary
 
-    void PutInt(int n);
+    void PutInt(int n);  // Write a number and a newline
+
+    void PutBuffer(char *buffer, int size);
+    // Write "size" characters, waiting
+    // until they have all gone out
 
    private:
     ConsoleOutput *consoleOutput;  // the hardware display
     Lock *lock;                    // only one writer at a time
     Semaphore *waitFor;            // wait for callBack
+    char *next;                    // the rest of the buffer being
+    int numLeft;                   // written, put out by CallBack
 
     void CallBack();  // called when more data can be written
 };
@@ -35,6 +35,7 @@
 #define SC_ThreadExit 14
 #define SC_ThreadJoin 15
 #define SC_PrintInt 16
+#define SC_PrintString 17
 #define SC_Add 42
 #define SC_MSG 100
 #ifndef IN_ASM
@@ -54,6 +55,9 @@ void Halt();
 
 /* Print Integer */
 void PrintInt(int number);
+
+/* Print a null-terminated string on the console, with no newline added */
+void PrintString(char *string);
 /*
  * Add the two operants and return the result
  */
@@ -82,7 +86,8 @@ SpaceId Exec(char *exec_name);
 
 /* Run the executable, stored in the Nachos file "argv[0]", with
  * parameters stored in argv[1..argc-1] and return the
- * address space identifier
+ * address space identifier, or -1 if there are too many
+ * arguments (or they are too long) to fit on the new program's stack
  */
 SpaceId ExecV(int argc, char *argv[]);
 
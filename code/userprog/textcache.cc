@@ -0,0 +1,223 @@
+// textcache.cc
+//	Routines to share the code pages of a program among all the
+//	address spaces running it.
+//
+//	An executable is identified by its file name, together with
+//	where its code segment is in the file and in memory, so a file
+//	rewritten with different code is not mistaken for the old one.
+//	There are few enough programs running at once that a list is
+//	good enough to find them.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "textcache.h"
+
+#include "copyright.h"
+#include "main.h"
+#include "pager.h"
+#include "synch.h"
+
+//----------------------------------------------------------------------
+// AllocateFrame, FreeFrame
+//	Get a physical page to hold shared code, or give one back.
+//	With demand paging, the pager finds the page (paging something
+//	out if need be, and returning -1 if it cannot); since the pager
+//	does not know the page is in use, it never pages it out.
+//----------------------------------------------------------------------
+
+static int
+AllocateFrame() {
+    if (kernel->pager != NULL) {
+        return kernel->pager->AllocateFrame();
+    }
+    int frame = kernel->frames->Allocate(NULL);
+
+    ASSERT(frame >= 0);  // caller checked there was room
+    return frame;
+}
+
+static void
+FreeFrame(int frame) {
+    kernel->frames->Free(frame);
+}
+
+//----------------------------------------------------------------------
+// SharedText::SharedText
+// 	Describe the code of an executable, and work out which virtual
+//	pages hold nothing but code.  No physical pages yet.
+//
+//	"fileName" -- the executable
+//	"code" -- its code segment, from the NOFF header
+//----------------------------------------------------------------------
+
+SharedText::SharedText(char *fileName, Segment *code) {
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    text = *code;
+    firstPage = divRoundUp(code->virtualAddr, PageSize);
+    numPages = (code->virtualAddr + code->size) / PageSize - firstPage;
+    if (numPages < 0) {
+        numPages = 0;
+    }
+    frames = new int[numPages > 0 ? numPages : 1];
+    refCount = 0;
+}
+
+//----------------------------------------------------------------------
+// SharedText::~SharedText
+// 	De-allocate the description (the physical pages must have
+//	been freed already).
+//----------------------------------------------------------------------
+
+SharedText::~SharedText() {
+    delete[] name;
+    delete[] frames;
+}
+
+//----------------------------------------------------------------------
+// SharedText::Matches
+// 	Return TRUE if this is the code of an executable.
+//
+//	"fileName" -- the executable
+//	"code" -- its code segment, from the NOFF header
+//----------------------------------------------------------------------
+
+bool SharedText::Matches(char *fileName, Segment *code) {
+    return strcmp(name, fileName) == 0 &&
+           text.virtualAddr == code->virtualAddr &&
+           text.inFileAddr == code->inFileAddr &&
+           text.size == code->size;
+}
+
+//----------------------------------------------------------------------
+// TextCache::TextCache
+// 	Initialize the cache; nothing is shared yet.
+//----------------------------------------------------------------------
+
+TextCache::TextCache() {
+    texts = new List<SharedText *>;
+    lock = new Lock("text cache");
+}
+
+//----------------------------------------------------------------------
+// TextCache::~TextCache
+// 	De-allocate the cache.
+//----------------------------------------------------------------------
+
+TextCache::~TextCache() {
+    while (!texts->IsEmpty()) {
+        delete texts->RemoveFront();
+    }
+    delete texts;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Find
+// 	Return the shared code of an executable, or NULL if no address
+//	space running it is left.
+//----------------------------------------------------------------------
+
+SharedText *
+TextCache::Find(char *fileName, Segment *code) {
+    ListIterator<SharedText *> iter(texts);
+
+    for (; !iter.IsDone(); iter.Next()) {
+        if (iter.Item()->Matches(fileName, code)) {
+            return iter.Item();
+        }
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// TextCache::NumCachedPages
+// 	Return how many pages of an executable's code are already in
+//	memory, so a new address space running it needs that many fewer.
+//----------------------------------------------------------------------
+
+int TextCache::NumCachedPages(char *fileName, Segment *code) {
+    SharedText *text = Find(fileName, code);
+
+    return (text != NULL) ? text->numPages : 0;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Acquire
+// 	Return the shared code pages of an executable, for a new address
+//	space to map.  The first time, the code pages are read from the
+//	executable into newly allocated physical pages.
+//
+//	Returns NULL if the code does not fill a single page.
+//
+//	Reading the code may wait for the disk, so this is done holding
+//	a lock, in case another thread wants the same program meanwhile.
+//
+//	"fileName" -- the executable
+//	"executable" -- the open executable, to read the code from
+//	"code" -- its code segment, from the NOFF header
+//----------------------------------------------------------------------
+
+SharedText *
+TextCache::Acquire(char *fileName, OpenFile *executable, Segment *code) {
+    SharedText *text;
+
+    lock->Acquire();
+    text = Find(fileName, code);
+    if (text == NULL) {
+        text = new SharedText(fileName, code);
+        if (text->numPages == 0) {
+            delete text;
+            lock->Release();
+            return NULL;
+        }
+        DEBUG(dbgAddr, "Loading " << text->numPages << " shared code pages of " << fileName);
+        for (int i = 0; i < text->numPages; i++) {
+            int frame = AllocateFrame();
+            int vaddr = (text->firstPage + i) * PageSize;
+
+            if (frame < 0) {
+                // no room: the caller loads the code privately
+                while (--i >= 0) {
+                    FreeFrame(text->frames[i]);
+                }
+                delete text;
+                lock->Release();
+                return NULL;
+            }
+            executable->ReadAt(&kernel->machine->mainMemory[frame * PageSize], PageSize,
+                               code->inFileAddr + (vaddr - code->virtualAddr));
+            kernel->machine->InvalidateDecodedPage(frame);
+            text->frames[i] = frame;
+        }
+        texts->Append(text);
+    }
+    text->refCount++;
+    lock->Release();
+    return text;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Release
+// 	Note that an address space no longer maps some shared code.
+//	When the last one lets go, the physical pages are freed.
+//	This is called when address spaces are deleted, with interrupts
+//	off, so it must not wait for the lock; it need not, since it
+//	never waits for anything in the middle.
+//
+//	"text" -- what Acquire returned
+//----------------------------------------------------------------------
+
+void TextCache::Release(SharedText *text) {
+    ASSERT(text->refCount > 0);
+    text->refCount--;
+    if (text->refCount == 0) {
+        for (int i = 0; i < text->numPages; i++) {
+            FreeFrame(text->frames[i]);
+        }
+        texts->Remove(text);
+        delete text;
+    }
+}
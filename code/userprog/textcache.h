@@ -0,0 +1,86 @@
+// textcache.h
+//	Data structures for sharing the code of a program among all
+//	the address spaces running it.
+//
+//	Code is never written, so when a program is run more than once,
+//	its code pages need to be read from the executable and kept in
+//	memory only once.  Each address space maps the shared physical
+//	pages read-only, and the last one to go away frees them.
+//
+//	Only the pages that hold nothing but code are shared; a page the
+//	code segment shares with data is copied into each address space
+//	as usual.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "copyright.h"
+#include "list.h"
+#include "noff.h"
+#include "openfile.h"
+
+class Lock;
+
+// The code pages of one executable, shared by the address spaces
+// running it.
+
+class SharedText {
+   public:
+    SharedText(char *fileName, Segment *code);  // describe the code
+    ~SharedText();                              // of an executable
+
+    bool Matches(char *fileName, Segment *code);
+    // Is this the code of that executable?
+
+    bool Contains(unsigned int vpn) {
+        return vpn >= (unsigned)firstPage && vpn < (unsigned)(firstPage + numPages);
+    }
+    // Is this virtual page shared?
+
+    int Frame(unsigned int vpn) { return frames[vpn - firstPage]; }
+    // The physical page a shared virtual page is in
+
+    int firstPage;  // first virtual page that holds only code
+    int numPages;   // number of such pages
+
+   private:
+    char *name;     // the executable's file name
+    Segment text;   // where the code is in the file and in memory
+    int *frames;    // the physical page of each shared page
+    int refCount;   // number of address spaces using it
+
+    friend class TextCache;
+};
+
+// The following class defines the kernel's cache of shared code.
+
+class TextCache {
+   public:
+    TextCache();   // Initialize an empty cache
+    ~TextCache();  // De-allocate the cache
+
+    int NumCachedPages(char *fileName, Segment *code);
+    // How many pages of this code are already
+    // in memory (and so need no new memory)?
+
+    SharedText *Acquire(char *fileName, OpenFile *executable, Segment *code);
+    // Get the shared code of an executable,
+    // loading it if nobody is running it yet.
+    // NULL if it has no page to share, or
+    // there is no memory to load it into.
+
+    void Release(SharedText *text);
+    // An address space is done with its code
+
+   private:
+    SharedText *Find(char *fileName, Segment *code);
+
+    List<SharedText *> *texts;  // code of the programs now running
+    Lock *lock;                 // one program loaded at a time
+};
+
+#endif  // TEXTCACHE_H
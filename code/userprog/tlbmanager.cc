@@ -0,0 +1,250 @@
+// tlbmanager.cc
+//	Routines to handle TLB misses: find the missing translation in
+//	the page table of the running address space, and load it into
+//	the TLB.
+//
+//	TLB entries are tagged with the address space they belong to,
+//	so switching address spaces does not flush the TLB; the
+//	entries of an address space are only thrown away when it is
+//	deleted.  Since the hardware sets the use and dirty bits in the
+//	TLB entry, they are copied back to the page table entry when
+//	the TLB entry is replaced.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "tlbmanager.h"
+
+#include "copyright.h"
+#include "main.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// TLBManager::TLBManager
+// 	Initialize the TLB miss handler.  The TLB must already exist.
+//
+//	"replacement" -- how to choose the entry to replace on a miss
+//----------------------------------------------------------------------
+
+TLBManager::TLBManager(TLBPolicy replacement) {
+    Machine *machine = kernel->machine;
+
+    ASSERT(machine->tlb != NULL);
+    policy = replacement;
+    pte = new TranslationEntry *[machine->tlbSize];
+    for (int i = 0; i < machine->tlbSize; i++) {
+        pte[i] = NULL;
+    }
+    clockHand = new int[machine->tlbSize / machine->tlbWays];
+    for (int i = 0; i < machine->tlbSize / machine->tlbWays; i++) {
+        clockHand[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// TLBManager::~TLBManager
+// 	De-allocate the TLB miss handler.
+//----------------------------------------------------------------------
+
+TLBManager::~TLBManager() {
+    delete[] pte;
+    delete[] clockHand;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::ParsePolicy
+// 	Convert the name of a replacement policy, as given on the
+//	command line.  Return FALSE if it is not one we know.
+//
+//	"name" -- "lru", "clock" or "random"
+//	"replacement" -- where to store the policy
+//----------------------------------------------------------------------
+
+bool TLBManager::ParsePolicy(char *name, TLBPolicy *replacement) {
+    if (strcmp(name, "lru") == 0) {
+        *replacement = TLBReplaceLRU;
+    } else if (strcmp(name, "clock") == 0) {
+        *replacement = TLBReplaceClock;
+    } else if (strcmp(name, "random") == 0) {
+        *replacement = TLBReplaceRandom;
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Evict
+// 	Invalidate a TLB entry, first copying the use and dirty bits
+//	the hardware set in it back to the page table entry it came from.
+//
+//	"entry" -- the index of the TLB entry
+//----------------------------------------------------------------------
+
+void TLBManager::Evict(int entry) {
+    TranslationEntry *tlbEntry = &kernel->machine->tlb[entry];
+
+    if (tlbEntry->valid && pte[entry] != NULL) {
+        pte[entry]->use |= tlbEntry->use;
+        pte[entry]->dirty |= tlbEntry->dirty;
+    }
+    tlbEntry->valid = FALSE;
+    pte[entry] = NULL;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::ChooseVictim
+// 	Pick the TLB entry to replace in a set.  An invalid entry is
+//	always used first; otherwise it depends on the policy:
+//
+//	LRU replaces the entry matched longest ago.
+//	Clock sweeps the set from where it last stopped, clearing use
+//	    bits (after saving them in the page table) until it finds an
+//	    entry whose use bit is already clear.
+//	Random replaces any entry of the set.
+//
+//	"set" -- the index of the first entry of the set
+//----------------------------------------------------------------------
+
+int TLBManager::ChooseVictim(int set) {
+    Machine *machine = kernel->machine;
+    int ways = machine->tlbWays;
+    int victim, i;
+
+    for (i = set; i < set + ways; i++) {
+        if (!machine->tlb[i].valid) {
+            return i;
+        }
+    }
+
+    switch (policy) {
+        case TLBReplaceLRU:
+            victim = set;
+            for (i = set + 1; i < set + ways; i++) {
+                if (machine->tlbLastUse[i] < machine->tlbLastUse[victim]) {
+                    victim = i;
+                }
+            }
+            return victim;
+
+        case TLBReplaceClock: {
+            int *hand = &clockHand[set / ways];
+            for (;;) {  // at most two trips around the set
+                victim = set + *hand;
+                *hand = (*hand + 1) % ways;
+                if (!machine->tlb[victim].use) {
+                    return victim;
+                }
+                if (pte[victim] != NULL) {
+                    pte[victim]->use = TRUE;
+                }
+                machine->tlb[victim].use = FALSE;
+            }
+        }
+
+        case TLBReplaceRandom:
+            return set + RandomNumber() % ways;
+    }
+    ASSERTNOTREACHED();
+    return set;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Refill
+// 	Handle a TLB miss for a virtual address in the running address
+//	space, by loading its page table entry into the TLB.  Afterwards
+//	the faulting instruction can simply be restarted.
+//
+//	Returns FALSE if the address is not mapped in the page table, in
+//	which case this is a real page fault.
+//
+//	"virtAddr" -- the virtual address that missed
+//----------------------------------------------------------------------
+
+bool TLBManager::Refill(int virtAddr) {
+    Machine *machine = kernel->machine;
+    AddrSpace *space = kernel->currentThread->space;
+    unsigned int vpn = (unsigned)virtAddr / PageSize;
+    TranslationEntry *entry;
+    int set, victim;
+
+    if (space == NULL) {
+        return FALSE;
+    }
+    entry = space->PageTableEntry(vpn);
+    if (entry == NULL || !entry->valid) {
+        return FALSE;
+    }
+
+    set = (vpn % (machine->tlbSize / machine->tlbWays)) * machine->tlbWays;
+    victim = ChooseVictim(set);
+    Evict(victim);
+
+    DEBUG(dbgAddr, "TLB refill: virtual page " << vpn << " -> entry " << victim);
+    machine->tlb[victim] = *entry;
+    machine->tlb[victim].use = FALSE;    // the page table keeps its own
+    machine->tlb[victim].dirty = FALSE;  // bits until we copy them back
+    machine->tlbASID[victim] = space->GetASID();
+    machine->tlbLastUse[victim] = machine->tlbUseCount;
+    pte[victim] = entry;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::FlushSpace
+// 	Invalidate the TLB entries of an address space that is being
+//	deleted.  Its page table is going away, so there is no point in
+//	copying the use and dirty bits back.
+//
+//	"asid" -- the address space
+//----------------------------------------------------------------------
+
+void TLBManager::FlushSpace(int asid) {
+    Machine *machine = kernel->machine;
+
+    for (int i = 0; i < machine->tlbSize; i++) {
+        if (machine->tlb[i].valid && machine->tlbASID[i] == asid) {
+            machine->tlb[i].valid = FALSE;
+            pte[i] = NULL;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// TLBManager::FlushPage
+// 	Invalidate the TLB entry (if any) loaded from a page table entry,
+//	because the page is being taken out of memory.  The use and dirty
+//	bits are copied back first, so the caller can tell whether the
+//	page has to be written out.
+//
+//	"entry" -- the page table entry
+//----------------------------------------------------------------------
+
+void TLBManager::FlushPage(TranslationEntry *entry) {
+    for (int i = 0; i < kernel->machine->tlbSize; i++) {
+        if (pte[i] == entry) {
+            Evict(i);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// TLBManager::SyncBits
+// 	Copy the use and dirty bits the hardware has set in the TLB back
+//	to the page table, so that page replacement sees them.  The use
+//	bits in the TLB are then cleared, so that pages referenced from
+//	now on are set again.
+//----------------------------------------------------------------------
+
+void TLBManager::SyncBits() {
+    TranslationEntry *tlb = kernel->machine->tlb;
+
+    for (int i = 0; i < kernel->machine->tlbSize; i++) {
+        if (tlb[i].valid && pte[i] != NULL) {
+            pte[i]->use |= tlb[i].use;
+            pte[i]->dirty |= tlb[i].dirty;
+            tlb[i].use = FALSE;
+        }
+    }
+}
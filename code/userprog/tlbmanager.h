@@ -0,0 +1,67 @@
+// tlbmanager.h
+//	Data structures for managing the software-loaded TLB on
+//	behalf of user programs.
+//
+//	When the machine is configured with a TLB (see Machine::tlb),
+//	the hardware only raises a PageFaultException on a miss; it is
+//	up to the kernel to find the translation in the address space's
+//	page table and load it into the TLB, choosing which entry of
+//	the set to replace.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLBMANAGER_H
+#define TLBMANAGER_H
+
+#include "copyright.h"
+#include "translate.h"
+
+// How to choose the TLB entry to replace, among those of a set
+enum TLBPolicy {
+    TLBReplaceLRU,     // the least recently matched entry
+    TLBReplaceClock,   // the next entry without its use bit set
+    TLBReplaceRandom   // any entry
+};
+
+// The following class defines the kernel's TLB miss handler.
+
+class TLBManager {
+   public:
+    TLBManager(TLBPolicy replacement);  // Initialize the TLB miss handler
+    ~TLBManager();                      // De-allocate the handler
+
+    bool Refill(int virtAddr);
+    // Load the translation for virtAddr, in the
+    // current address space, into the TLB.
+    // Return FALSE if the page isn't mapped.
+
+    void FlushSpace(int asid);
+    // Forget the TLB entries of an address
+    // space that is going away
+
+    void FlushPage(TranslationEntry *entry);
+    // Forget the TLB entry loaded from a page
+    // table entry, copying its bits back first
+
+    void SyncBits();
+    // Copy the use and dirty bits of every TLB
+    // entry back to the page table, and clear
+    // the use bits so new references are seen
+
+    static bool ParsePolicy(char *name, TLBPolicy *replacement);
+    // Convert "lru", "clock" or "random"
+
+   private:
+    TLBPolicy policy;         // how to choose an entry to replace
+    TranslationEntry **pte;   // the page table entry each TLB
+                              // entry was loaded from, or NULL
+    int *clockHand;           // next entry to look at, for each set
+
+    int ChooseVictim(int set);  // pick an entry of a set to replace
+    void Evict(int entry);      // copy an entry's use/dirty bits back
+                                // to the page table, and invalidate it
+};
+
+#endif  // TLBMANAGER_H
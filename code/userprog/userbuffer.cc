@@ -0,0 +1,239 @@
+// userbuffer.cc
+//	Routines to let system calls read and write the memory of the
+//	user program that called them, through its page table.
+//
+//	Pages are looked up in the page table directly, rather than with
+//	Machine::ReadMem and WriteMem: that is one lookup per page,
+//	rather than per byte.  A page that is not in memory is brought
+//	in by the pager, and one shared copy-on-write gets its own copy
+//	before the kernel writes to it, just as if the user program had
+//	touched it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "userbuffer.h"
+
+#include "copyright.h"
+#include "main.h"
+#include "pager.h"
+
+#include <limits.h>
+
+//----------------------------------------------------------------------
+// UserBuffer::UserPage
+// 	Return the physical page that holds a virtual page of the
+//	current address space, bringing it into memory first if need
+//	be, and (if the kernel is to write to it) giving it a copy of
+//	its own if it is shared copy-on-write.  The use and dirty bits
+//	are set, as if the user program had made the access.
+//
+//	Returns -1 if the page is outside the address space, or is to
+//	be written to and really is read-only.
+//
+//	"vpn" -- the virtual page
+//	"writing" -- will the kernel write to it?
+//----------------------------------------------------------------------
+
+int UserBuffer::UserPage(unsigned int vpn, bool writing) {
+    AddrSpace *space = kernel->currentThread->space;
+    TranslationEntry *entry;
+
+    if (space == NULL || (entry = space->PageTableEntry(vpn)) == NULL) {
+        return -1;
+    }
+    if (!entry->valid) {
+        if (kernel->pager == NULL || !kernel->pager->PageIn(vpn)) {
+            return -1;
+        }
+        ASSERT(entry->valid);
+    }
+    if (writing && entry->readOnly && !space->CopyOnWrite(vpn)) {
+        return -1;
+    }
+    entry->use = TRUE;
+    if (writing) {
+        entry->dirty = TRUE;
+    }
+    return entry->physicalPage;
+}
+
+//----------------------------------------------------------------------
+// UserBuffer::UserBuffer
+// 	Find where in main memory each page of a user buffer is, and
+//	pin it there.  Each page is looked up once; a page is pinned as
+//	soon as it is found, so bringing in a later page cannot page out
+//	an earlier one.
+//
+//	The buffer is not valid if it does not fit between 0 and the
+//	largest address, without wrapping around, or if it goes past
+//	the end of the address space.
+//
+//	"vaddr" -- the virtual address of the buffer
+//	"size" -- the number of bytes in it
+//	"writing" -- TRUE if the kernel will write to the buffer
+//----------------------------------------------------------------------
+
+UserBuffer::UserBuffer(int vaddr, int size, bool writing) {
+    AddrSpace *space = kernel->currentThread->space;
+    unsigned int firstPage = 0, lastPage;
+    int numPages = 0;
+    char *mainMemory = kernel->machine->mainMemory;
+
+    this->size = size;
+    this->writing = writing;
+    valid = (vaddr >= 0 && size >= 0 && vaddr <= INT_MAX - size);
+    if (valid && size > 0) {
+        firstPage = (unsigned)vaddr / PageSize;
+        lastPage = (unsigned)(vaddr + size - 1) / PageSize;
+        if (space == NULL || space->PageTableEntry(lastPage) == NULL) {
+            valid = FALSE;
+        } else {
+            numPages = lastPage - firstPage + 1;
+        }
+    }
+    numPieces = 0;
+    numFrames = 0;
+    pieces = new char *[numPages > 0 ? numPages : 1];
+    pieceSizes = new int[numPages > 0 ? numPages : 1];
+    frames = new int[numPages > 0 ? numPages : 1];
+
+    for (int i = 0; valid && i < numPages; i++) {
+        int frame = UserPage(firstPage + i, writing);
+        int start = (i == 0) ? (unsigned)vaddr % PageSize : 0;
+        int end = (i == numPages - 1) ? (unsigned)(vaddr + size - 1) % PageSize + 1
+                                      : PageSize;
+
+        if (frame < 0) {
+            valid = FALSE;
+            break;
+        }
+        kernel->frames->Pin(frame);
+        frames[numFrames++] = frame;
+
+        if (numPieces > 0 && frame == frames[numFrames - 2] + 1) {
+            pieceSizes[numPieces - 1] += end - start;  // contiguous
+        } else {
+            pieces[numPieces] = &mainMemory[frame * PageSize + start];
+            pieceSizes[numPieces] = end - start;
+            numPieces++;
+        }
+    }
+    if (!valid) {
+        numPieces = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// UserBuffer::~UserBuffer
+// 	Unpin the pages of the buffer.  If the kernel wrote to them, any
+//	instructions predecoded from them are stale.
+//----------------------------------------------------------------------
+
+UserBuffer::~UserBuffer() {
+    for (int i = 0; i < numFrames; i++) {
+        if (writing) {
+            kernel->machine->InvalidateDecodedPage(frames[i]);
+        }
+        kernel->frames->Unpin(frames[i]);
+    }
+    delete[] pieces;
+    delete[] pieceSizes;
+    delete[] frames;
+}
+
+//----------------------------------------------------------------------
+// UserBuffer::ReadString
+// 	Copy a null-terminated string out of the current program's
+//	memory, a page at a time.  Returns the string in a new[] array,
+//	or NULL if it is longer than "maxSize" bytes (with the null), or
+//	runs off the end of the address space.
+//
+//	"vaddr" -- the virtual address of the string
+//	"maxSize" -- the largest string to accept
+//----------------------------------------------------------------------
+
+char *UserBuffer::ReadString(int vaddr, int maxSize) {
+    char *string = new char[maxSize];
+    int copied = 0;
+
+    while (copied < maxSize) {
+        int addr = vaddr + copied;
+        int frame = (addr >= 0) ? UserPage((unsigned)addr / PageSize, FALSE) : -1;
+        char *from;
+        int left;
+
+        if (frame < 0) {
+            break;
+        }
+        from = &kernel->machine->mainMemory[frame * PageSize + addr % PageSize];
+        left = min(PageSize - addr % PageSize, maxSize - copied);
+        for (int i = 0; i < left; i++) {
+            string[copied++] = from[i];
+            if (from[i] == '\0') {
+                return string;
+            }
+        }
+    }
+    delete[] string;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// UserBuffer::StringLength
+// 	Return the length of a null-terminated string in the current
+//	program's memory (not counting the null), looking at a page at
+//	a time.  Returns -1 in the same cases as ReadString.  The string
+//	itself can then be got at in place, with a UserBuffer.
+//
+//	"vaddr" -- the virtual address of the string
+//	"maxSize" -- the largest string to accept
+//----------------------------------------------------------------------
+
+int UserBuffer::StringLength(int vaddr, int maxSize) {
+    int length = 0;
+
+    while (length < maxSize) {
+        int addr = vaddr + length;
+        int frame = (addr >= 0) ? UserPage((unsigned)addr / PageSize, FALSE) : -1;
+        char *from;
+        int left;
+
+        if (frame < 0) {
+            break;
+        }
+        from = &kernel->machine->mainMemory[frame * PageSize + addr % PageSize];
+        left = min(PageSize - addr % PageSize, maxSize - length);
+        for (int i = 0; i < left; i++) {
+            if (from[i] == '\0') {
+                return length + i;
+            }
+        }
+        length += left;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// UserBuffer::ReadWord
+// 	Read a word of the current program's memory.  Returns FALSE if
+//	the address is not word-aligned, or not in the address space.
+//
+//	"vaddr" -- the virtual address of the word
+//	"value" -- where to put it
+//----------------------------------------------------------------------
+
+bool UserBuffer::ReadWord(int vaddr, int *value) {
+    int frame;
+
+    if (vaddr < 0 || vaddr % 4 != 0) {
+        return FALSE;
+    }
+    frame = UserPage((unsigned)vaddr / PageSize, FALSE);
+    if (frame < 0) {
+        return FALSE;
+    }
+    *value = WordToHost(*(unsigned int *)&kernel->machine->mainMemory[frame * PageSize + vaddr % PageSize]);
+    return TRUE;
+}
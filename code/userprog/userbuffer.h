@@ -0,0 +1,72 @@
+// userbuffer.h
+//	Data structures for system calls to get at the memory of the
+//	user program that called them.
+//
+//	A user program passes buffers by their virtual address, but the
+//	pages of a buffer may be anywhere in physical memory, or not in
+//	memory at all.  A UserBuffer looks up each page once, bringing it
+//	in if need be, and describes the buffer as a list of pieces of
+//	main memory (pages next to each other in physical memory are
+//	put in one piece).  The kernel can then read or write the
+//	buffer in place, with no copying.
+//
+//	The pages of a buffer are pinned while it exists, so the pager
+//	cannot take them away while the kernel waits for a device.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef USERBUFFER_H
+#define USERBUFFER_H
+
+#include "copyright.h"
+
+// The following class defines a buffer in the address space of the
+// current thread, as a scatter/gather list of pieces of main memory.
+
+class UserBuffer {
+   public:
+    UserBuffer(int vaddr, int size, bool writing);
+    // Find the pieces of a buffer, to be
+    // written to if "writing"
+    ~UserBuffer();  // Let the pager have the pages again
+
+    bool IsValid() { return valid; }
+    // FALSE if part of the buffer is not in
+    // the address space (or, when writing,
+    // is read-only); then it has no pieces
+
+    int Size() { return size; }
+    int NumPieces() { return numPieces; }
+    char *Piece(int i) { return pieces[i]; }
+    int PieceSize(int i) { return pieceSizes[i]; }
+    // Where each piece is, and how big
+
+    static char *ReadString(int vaddr, int maxSize);
+    // Copy a null-terminated string out of
+    // user memory, into a new[] array; NULL
+    // if it is longer than maxSize (counting
+    // the null) or not all in memory
+    static int StringLength(int vaddr, int maxSize);
+    // Length of a null-terminated string in
+    // user memory, or -1 as for ReadString
+    static bool ReadWord(int vaddr, int *value);
+    // Read a word of user memory
+
+   private:
+    static int UserPage(unsigned int vpn, bool writing);
+    // The physical page holding a virtual
+    // page, or -1 if it is not accessible
+
+    int size;           // bytes in the buffer
+    bool writing;       // will the kernel write to it?
+    bool valid;         // is it all accessible?
+    int numPieces;      // how many pieces it is in
+    char **pieces;      // where each piece is in main memory
+    int *pieceSizes;    // and how many bytes
+    int numFrames;      // how many physical pages it is in
+    int *frames;        // each of them (pinned)
+};
+
+#endif  // USERBUFFER_H